@@ -0,0 +1,376 @@
+#include <curses.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "collector.h"
+#include "exporter.h"
+#include "fd_cache.h"
+#include "filter_index.h"
+#include "linux_parser.h"
+#include "ncurses_display.h"
+#include "options.h"
+#include "proc_reader.h"
+#include "procfs_fixture.h"
+#include "process_table.h"
+#include "snapshot.h"
+#include "system.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+/*
+Micro benchmarks of the monitor against synthetic procfs trees. Every
+benchmark reports the time and the number of heap allocations per op.
+*/
+
+namespace {
+std::atomic<long> allocations{0};
+}  // namespace
+
+// Count every heap allocation of the process
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* memory = malloc(size == 0 ? 1 : size)) return memory;
+  throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  vector<int> sizes{1000, 10000, 100000};
+  unsigned max_threads{std::max(1u, std::thread::hardware_concurrency())};
+  double seconds{0.5};
+  string generate;
+};
+
+// Runs op until the time budget is used up, at least once after a warm up
+// run. ops_per_call scales the results, e.g. to report per process.
+template <typename Op>
+void Measure(string const& name, int pids, double seconds, long ops_per_call,
+             Op op) {
+  op();
+  long calls{0};
+  long const allocations_before = allocations.load();
+  Clock::time_point const start = Clock::now();
+  std::chrono::duration<double> elapsed{0};
+  do {
+    op();
+    ++calls;
+    elapsed = Clock::now() - start;
+  } while (elapsed.count() < seconds);
+  double const ops = double(calls) * ops_per_call;
+  printf("%-34s %8d %14.1f %12.2f\n", name.c_str(), pids,
+         elapsed.count() * 1e9 / ops,
+         (allocations.load() - allocations_before) / ops);
+  fflush(stdout);
+}
+
+void BenchParser(vector<int> const& pids, double seconds) {
+  int const n = pids.size();
+  SystemSnapshot snapshot;
+  Measure("parser/system_snapshot", n, seconds, 1,
+          [&] { LinuxParser::ReadSystemSnapshot(snapshot); });
+  vector<int> found;
+  Measure("parser/pids", n, seconds, 1, [&] { LinuxParser::Pids(found); });
+  LinuxParser::ProcessSample sample;
+  Measure("parser/process_sample", n, seconds, n, [&] {
+    for (int pid : pids) LinuxParser::ReadProcessSample(pid, sample);
+  });
+  // The same through fds kept open, as far as RLIMIT_NOFILE allows
+  {
+    FdCache cache;
+    vector<LinuxParser::ProcessFiles> files(pids.size());
+    Measure("parser/process_sample_cached", n, seconds, n, [&] {
+      for (size_t i = 0; i < pids.size(); ++i) {
+        LinuxParser::ReadProcessSample(pids[i], sample, &files[i], &cache);
+      }
+    });
+  }
+  Measure("parser/uid", n, seconds, n, [&] {
+    for (int pid : pids) LinuxParser::Uid(pid);
+  });
+  Measure("parser/command", n, seconds, n, [&] {
+    for (int pid : pids) LinuxParser::Command(pid);
+  });
+}
+
+// Every tick swaps 1% of the PIDs for new ones and back again
+void BenchReconcile(vector<int> const& pids, double seconds) {
+  int const n = pids.size();
+  vector<int> churned = pids;
+  for (int i = 0; i < n; i += 100) churned[i] += n;
+  ProcessTable table;
+  bool flip{false};
+  Measure("table/reconcile_1%_churn", n, seconds, 1, [&] {
+    table.Reconcile((flip = !flip) ? churned : pids);
+  });
+}
+
+// A steady state tick for each worker count, from one up to all cores
+void BenchTick(vector<int> const& pids, unsigned max_threads, double seconds) {
+  for (unsigned threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    Options options;
+    options.threads = threads;
+    System system(options);
+    Measure("system/tick/threads=" + std::to_string(threads), pids.size(),
+            seconds, 1, [&] {
+              system.Refresh();
+              system.Processes(SortKey::kCpu, 10);
+            });
+    if (threads == max_threads) break;
+  }
+  // The same tick with every process read, as without idle backoff
+  Options options;
+  options.threads = max_threads;
+  options.idle_interval = 1;
+  System system(options);
+  Measure("system/tick/sample_all", pids.size(), seconds, 1, [&] {
+    system.Refresh();
+    system.Processes(SortKey::kCpu, 10);
+  });
+}
+
+// Starts a collector on a new system and waits for the first published
+// snapshot that is done. Only the time until then is reported, without
+// the teardown, and every run starts from a cold system.
+template <typename Done>
+void MeasureStartup(string const& name, int pids, double seconds,
+                    Done done) {
+  long runs{0};
+  long allocations_total{0};
+  std::chrono::duration<double> total{0};
+  do {
+    Options options;
+    long const allocations_before = allocations.load();
+    Clock::time_point const start = Clock::now();
+    System system(options);
+    Collector collector(system);
+    collector.Start();
+    while (!done(collector.Latest())) std::this_thread::yield();
+    total += Clock::now() - start;
+    allocations_total += allocations.load() - allocations_before;
+    ++runs;
+  } while (total.count() < seconds);
+  printf("%-34s %8d %14.1f %12.2f\n", name.c_str(), pids,
+         total.count() * 1e9 / runs, double(allocations_total) / runs);
+  fflush(stdout);
+}
+
+// The system pane comes first, then the processes batch by batch
+void BenchStartup(vector<int> const& pids, double seconds) {
+  int const n = pids.size();
+  MeasureStartup("startup/first_frame", n, seconds,
+                 [](Snapshot const& snapshot) { return snapshot.tick > 0; });
+  MeasureStartup("startup/first_rows", n, seconds,
+                 [](Snapshot const& snapshot) {
+                   return !snapshot.rows.empty();
+                 });
+  MeasureStartup("startup/full_table", n, seconds,
+                 [n](Snapshot const& snapshot) {
+                   return snapshot.process_count == size_t(n);
+                 });
+}
+
+void BenchSort(vector<int> const& pids, double seconds) {
+  int const n = pids.size();
+  Options options;
+  System system(options);
+  system.Refresh();
+  system.Processes();
+  Measure("sort/top10_cpu", n, seconds, 1,
+          [&] { system.Order(SortKey::kCpu, 10); });
+  Measure("sort/top10_user", n, seconds, 1,
+          [&] { system.Order(SortKey::kUser, 10); });
+  Measure("sort/full_cpu", n, seconds, 1,
+          [&] { system.Order(SortKey::kCpu, System::kAllProcesses); });
+}
+
+// A filter looks its processes up in the index, the scan is what it
+// would cost to match every command instead
+void BenchFilter(vector<int> const& pids, double seconds) {
+  int const n = pids.size();
+  Options options;
+  System system(options);
+  system.Refresh();
+  system.Processes();
+  ProcessFilter filter;
+  ProcessFilter::Parse("--id " + std::to_string(pids[n / 2]), filter);
+  Measure("filter/command", n, seconds, 1, [&] {
+    system.Filter(filter);
+    system.Order(SortKey::kCpu, 10);
+  });
+  ProcessFilter::Parse("pid=100-199", filter);
+  Measure("filter/pid_range", n, seconds, 1, [&] {
+    system.Filter(filter);
+    system.Order(SortKey::kCpu, 10);
+  });
+  system.Filter(ProcessFilter());
+  string const text = "--id " + std::to_string(pids[n / 2]);
+  vector<Process*> matches;
+  Measure("filter/scan_command", n, seconds, 1, [&] {
+    matches.clear();
+    for (Process* process : system.AllProcesses()) {
+      if (process->Command().find(text) != string::npos) {
+        matches.push_back(process);
+      }
+    }
+  });
+}
+
+// Draws into a terminal that writes to /dev/null
+void BenchRender(vector<int> const& pids, double seconds) {
+  Options options;
+  System system(options);
+  Collector collector(system);
+  Snapshot snapshot;
+  collector.Collect(snapshot, SortKey::kCpu, 10);
+
+  FILE* out = fopen("/dev/null", "w");
+  FILE* in = fopen("/dev/null", "r");
+  char const* term = getenv("TERM");
+  SCREEN* screen = newterm(term != nullptr ? term : "xterm", out, in);
+  if (screen == nullptr) {
+    printf("%-34s %8zu %14s\n", "render/frame", pids.size(), "no terminal");
+    fclose(out);
+    fclose(in);
+    return;
+  }
+  start_color();
+  WINDOW* system_window = newwin(9, 120, 0, 0);
+  WINDOW* process_window = newwin(13, 120, 9, 0);
+  ScreenBuffer system_screen;
+  ScreenBuffer process_screen;
+  system_screen.Resize(9, 120);
+  process_screen.Resize(13, 120);
+  Measure("render/frame", pids.size(), seconds, 1, [&] {
+    system_screen.Clear();
+    NCursesDisplay::DisplaySystem(snapshot, system_screen);
+    system_screen.Flush(system_window);
+    process_screen.Clear();
+    NCursesDisplay::DisplayProcesses(snapshot, process_screen, 10);
+    process_screen.Flush(process_window);
+    wnoutrefresh(system_window);
+    wnoutrefresh(process_window);
+    doupdate();
+  });
+  delwin(process_window);
+  delwin(system_window);
+  endwin();
+  delscreen(screen);
+  fclose(out);
+  fclose(in);
+}
+
+// Serializing happens once per tick whatever the number of scrapes
+void BenchExport(vector<int> const& pids, double seconds) {
+  Options options;
+  System system(options);
+  Collector collector(system);
+  Snapshot snapshot;
+  collector.Collect(snapshot, SortKey::kCpu, 100);
+  string body;
+  Measure("export/serialize_top100", pids.size(), seconds, 1, [&] {
+    body.clear();
+    Exporter::Serialize(snapshot, body);
+  });
+}
+
+vector<int> ParseSizes(string_view list) {
+  vector<int> sizes;
+  Tokenizer tokens(list);
+  int size;
+  while (tokens.NextNumber(size, ',')) sizes.push_back(size);
+  if (sizes.empty()) throw std::invalid_argument("--pids needs sizes");
+  return sizes;
+}
+
+BenchOptions ParseBenchOptions(int argc, char* argv[]) {
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    string_view option(argv[i]);
+    if (i + 1 >= argc) {
+      throw std::invalid_argument("unknown option " + string(option));
+    }
+    string_view value(argv[++i]);
+    if (option == "--pids") {
+      options.sizes = ParseSizes(value);
+    } else if (option == "--threads") {
+      if (!ParseNumber(value, options.max_threads) || options.max_threads < 1)
+        throw std::invalid_argument("--threads needs a positive number");
+    } else if (option == "--seconds") {
+      if (!ParseNumber(value, options.seconds))
+        throw std::invalid_argument("--seconds needs a number");
+    } else if (option == "--generate") {
+      options.generate = string(value);
+    } else {
+      throw std::invalid_argument("unknown option " + string(option));
+    }
+  }
+  return options;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchOptions options;
+  try {
+    options = ParseBenchOptions(argc, argv);
+  } catch (std::invalid_argument const& error) {
+    std::cerr << error.what() << "\n"
+              << "usage: " << argv[0]
+              << " [--pids 1000,10000,100000] [--threads MAX] [--seconds S]\n"
+                 "       "
+              << argv[0] << " --generate DIR [--pids N]\n";
+    return 1;
+  }
+
+  // Only write a tree, e.g. to run the monitor on it with --proc-root and
+  // --cgroup-root DIR/cgroup
+  if (!options.generate.empty()) {
+    ProcfsFixture::Write(options.generate, options.sizes.front());
+    return 0;
+  }
+
+  printf("%-34s %8s %14s %12s\n", "benchmark", "pids", "ns/op", "allocs/op");
+  for (int size : options.sizes) {
+    char root[] = "/tmp/monitor_bench.XXXXXX";
+    if (mkdtemp(root) == nullptr) {
+      perror("mkdtemp");
+      return 1;
+    }
+    vector<int> pids = ProcfsFixture::Write(root, size);
+    LinuxParser::SetProcDirectory(root);
+    LinuxParser::SetCgroupDirectory(string(root) + "/cgroup");
+
+    BenchParser(pids, options.seconds);
+    BenchReconcile(pids, options.seconds);
+    BenchTick(pids, options.max_threads, options.seconds);
+    BenchStartup(pids, options.seconds);
+    BenchSort(pids, options.seconds);
+    BenchFilter(pids, options.seconds);
+    BenchRender(pids, options.seconds);
+    BenchExport(pids, options.seconds);
+
+    std::filesystem::remove_all(root);
+  }
+  return 0;
+}
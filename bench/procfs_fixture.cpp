@@ -0,0 +1,129 @@
+#include "procfs_fixture.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace {
+void WriteFile(string const& path, char const* content, size_t size) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0 || write(fd, content, size) != ssize_t(size)) {
+    if (fd >= 0) close(fd);
+    throw std::runtime_error("cannot write " + path);
+  }
+  close(fd);
+}
+
+void WriteFile(string const& path, string const& content) {
+  WriteFile(path, content.data(), content.size());
+}
+
+// A 64 core machine, the per core lines make /proc/stat realistically long
+void WriteSystem(string const& root, int count) {
+  string stat = "cpu  4705 356 584 3699176 2306 0 78 0 0 0\n";
+  char line[128];
+  for (int cpu = 0; cpu < 64; ++cpu) {
+    snprintf(line, sizeof(line), "cpu%d 73 5 9 57799 36 0 1 0 0 0\n", cpu);
+    stat += line;
+  }
+  snprintf(line, sizeof(line),
+           "intr 114930548 113199788 3 0 5 263 0 4 [...]\n"
+           "ctxt 1990473\nbtime 1062191376\nprocesses %d\n"
+           "procs_running 3\nprocs_blocked 0\n",
+           count);
+  stat += line;
+  WriteFile(root + "/stat", stat);
+  WriteFile(root + "/meminfo",
+            "MemTotal:       16318412 kB\n"
+            "MemFree:         9218612 kB\n"
+            "MemAvailable:   12431008 kB\n"
+            "Buffers:          216744 kB\n"
+            "Cached:          3031864 kB\n");
+  WriteFile(root + "/uptime", "86400.42 5123456.78\n");
+  WriteFile(root + "/version",
+            "Linux version 6.1.0-synthetic (bench@fixture) (gcc 12.2.0) #1 "
+            "SMP PREEMPT_DYNAMIC\n");
+}
+
+// The processes are spread over kUnits services, their cgroups are kept
+// next to the processes in a cgroup directory
+constexpr int kUnits{32};
+
+void WriteCgroups(string const& root) {
+  string dir = root + "/cgroup";
+  mkdir(dir.c_str(), 0755);
+  dir += "/bench.slice";
+  mkdir(dir.c_str(), 0755);
+  char content[256];
+  for (int unit = 0; unit < kUnits; ++unit) {
+    string const unit_dir = dir + "/unit-" + std::to_string(unit) + ".service";
+    mkdir(unit_dir.c_str(), 0755);
+    int size = snprintf(content, sizeof(content),
+                        "usage_usec %ld\nuser_usec %ld\nsystem_usec %ld\n"
+                        "nr_periods 0\nnr_throttled 0\nthrottled_usec 0\n",
+                        unit * 7000000L, unit * 5000000L, unit * 2000000L);
+    WriteFile(unit_dir + "/cpu.stat", content, size);
+    size = snprintf(content, sizeof(content), "%ld\n",
+                    (unit + 1) * 16L * 1024 * 1024);
+    WriteFile(unit_dir + "/memory.current", content, size);
+  }
+}
+
+void WriteProcess(string const& root, int pid) {
+  string const dir = root + "/" + std::to_string(pid);
+  mkdir(dir.c_str(), 0755);
+  // Spread start times, CPU times and memory so that orderings differ
+  long const starttime = 1000 + (pid * 7919L) % 8000000;
+  long const utime = (pid * 131L) % 50000;
+  long const stime = (pid * 17L) % 9000;
+  long const pages = 1000 + (pid * 37L) % 500000;
+  int const uid = pid % 3 == 0 ? 0 : 65534;
+  char content[512];
+  int size = snprintf(content, sizeof(content),
+                      "%d (worker %d) S 1 %d %d 0 -1 4194560 100 0 0 0 %ld "
+                      "%ld 0 0 20 0 1 0 %ld %ld %ld 18446744073709551615 1 1 "
+                      "0 0 0 0 0 0 0 0 0 0 17 %d 0 0 0 0 0\n",
+                      pid, pid, pid, pid, utime, stime, starttime, pages * 4096,
+                      pages / 4, pid % 64);
+  WriteFile(dir + "/stat", content, size);
+  size = snprintf(content, sizeof(content), "%ld %ld 300 200 0 %ld 0\n", pages,
+                  pages / 4, pages / 2);
+  WriteFile(dir + "/statm", content, size);
+  size = snprintf(content, sizeof(content),
+                  "Name:\tworker\nUmask:\t0022\nState:\tS (sleeping)\n"
+                  "Tgid:\t%d\nNgid:\t0\nPid:\t%d\nPPid:\t1\nTracerPid:\t0\n"
+                  "Uid:\t%d\t%d\t%d\t%d\nGid:\t%d\t%d\t%d\t%d\n"
+                  "FDSize:\t64\nVmPeak:\t%ld kB\nVmSize:\t%ld kB\n"
+                  "VmRSS:\t%ld kB\nThreads:\t1\n",
+                  pid, pid, uid, uid, uid, uid, uid, uid, uid, uid, pages * 4,
+                  pages * 4, pages);
+  WriteFile(dir + "/status", content, size);
+  size = snprintf(content, sizeof(content),
+                  "/usr/bin/worker%c--id%c%d%c--config%c/etc/worker.conf%c", 0,
+                  0, pid, 0, 0, 0);
+  WriteFile(dir + "/cmdline", content, size);
+  size = snprintf(content, sizeof(content),
+                  "0::/bench.slice/unit-%d.service\n", pid % kUnits);
+  WriteFile(dir + "/cgroup", content, size);
+}
+}  // namespace
+
+vector<int> ProcfsFixture::Write(string const& root, int count) {
+  mkdir(root.c_str(), 0755);
+  WriteSystem(root, count);
+  WriteCgroups(root);
+  vector<int> pids;
+  for (int pid = 1; pid <= count; ++pid) {
+    WriteProcess(root, pid);
+    pids.push_back(pid);
+  }
+  return pids;
+}
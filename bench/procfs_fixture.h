@@ -0,0 +1,18 @@
+#ifndef PROCFS_FIXTURE_H
+#define PROCFS_FIXTURE_H
+
+#include <string>
+#include <vector>
+
+/*
+Writes a synthetic procfs tree with the files the monitor reads: stat,
+meminfo, uptime and version at the top and stat, statm, status, cmdline
+and cgroup for every process. Point LinuxParser::SetProcDirectory at it
+and LinuxParser::SetCgroupDirectory at its cgroup directory.
+*/
+namespace ProcfsFixture {
+// Writes the tree for the processes 1 to count, returns their PIDs
+std::vector<int> Write(std::string const& root, int count);
+};  // namespace ProcfsFixture
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include "collector.h"
+#include "options.h"
+
+/*
+Streams the samples of this host to an aggregator in the RecordFormat.
+Only the fields of processes that changed since the last tick are sent,
+so the traffic follows the churn on the host rather than the number of
+processes. A lost connection is opened again at the next tick and starts
+a new stream.
+*/
+namespace Agent {
+// Streams to options.agent_address, returns the exit code
+int Run(Collector& collector, Options const& options);
+};  // namespace Agent
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <poll.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "process.h"
+#include "record_session.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+#include "socket_address.h"
+
+/*
+Merges the streams of many agents into one process list with the host of
+every process. Agents connect whenever they like and are dropped when
+they disconnect or send something that is no stream. All sockets are
+non-blocking and read from the display thread between two key presses,
+so a slow or stuck agent holds nobody up.
+*/
+class Aggregator : public SnapshotSource {
+ public:
+  Aggregator() = default;
+  ~Aggregator();
+  Aggregator(Aggregator const&) = delete;
+  Aggregator& operator=(Aggregator const&) = delete;
+
+  // Returns false with errno set if the address cannot be listened on
+  bool Listen(SocketAddress const& address);
+  void Request(SortKey key, std::size_t rows, std::size_t first = 0) override;
+  Snapshot const& Latest(bool* fresh = nullptr) override;
+
+ private:
+  struct Connection {
+    int fd{-1};
+    // Bytes received and not yet applied start at offset
+    std::string buffer;
+    std::size_t offset{0};
+    bool started{false};
+    RecordSession session;
+  };
+  void Accept();
+  bool Receive(Connection& connection, bool& ticked);
+  void Name(Connection& connection);
+
+  int listener_{-1};
+  std::string path_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::vector<pollfd> polled_;
+  std::vector<RecordSession const*> sessions_;
+  SessionMerger merger_;
+  SortKey key_{SortKey::kCpu};
+  std::size_t rows_{10};
+  std::size_t first_{0};
+  bool changed_{true};
+  unsigned long tick_{0};
+  Snapshot snapshot_;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CGROUP_TABLE_H
+#define CGROUP_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu_history.h"
+#include "process.h"
+
+// A cgroup with the processes in it and its own accounting
+struct ControlGroup {
+  std::string path;
+  int processes{0};
+  // CPU time in microseconds against the uptime, like for processes
+  CpuHistory history;
+  long memory_kb{-1};
+  bool readable{false};
+};
+
+/*
+The cgroups the processes on the system belong to. A process is mapped
+to its cgroup once when it is loaded; every tick only counts processes
+per cgroup and reads the accounting of every populated cgroup once, so
+the usage of a service costs the same however many processes it runs and
+includes the ones that already exited. A cgroup that no process maps to
+any more is dropped and its slot is taken by the next new cgroup, so
+short-lived cgroups such as transient scopes do not pile up.
+*/
+class CgroupTable {
+ public:
+  static constexpr uint32_t kNone = UINT32_MAX;
+  // Returns the ID of the cgroup, kNone for an empty path
+  uint32_t Intern(std::string const& path);
+  // Counts the processes of every cgroup and drops the empty ones, the
+  // processes passed have to be all that hold an ID
+  void Count(std::vector<Process*> const& processes);
+  // The number of populated cgroups as of the last Count
+  std::size_t Size() const;
+  // Reads the accounting of the i-th populated cgroup, cgroups can be
+  // sampled in parallel
+  void Sample(std::size_t i, double uptime, CpuHistoryConfig const& config);
+  // The first n populated cgroups, ordered by CPU, memory or else path
+  std::vector<ControlGroup const*> const& Order(SortKey key, std::size_t n);
+
+ private:
+  std::vector<ControlGroup> cgroups_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  // Slots of dropped cgroups, their path is empty
+  std::vector<uint32_t> free_;
+  std::vector<uint32_t> populated_;
+  std::vector<ControlGroup const*> order_;
+};
+
+#endif
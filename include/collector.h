@@ -0,0 +1,80 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filter_index.h"
+#include "overhead.h"
+#include "process.h"
+#include "recorder.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+#include "system.h"
+
+/*
+Samples the system on its own thread and publishes a Snapshot per tick.
+The renderer picks up the latest snapshot without locks and never waits
+for procfs. Ticks start a fixed period apart, so the refresh rate does
+not depend on how long a scan takes. The first tick is published bit by
+bit: the system values first, then the processes batch by batch.
+*/
+class Collector : public SnapshotSource {
+ public:
+  explicit Collector(System& system, std::chrono::milliseconds period =
+                                         std::chrono::seconds(1));
+  ~Collector();
+  Collector(Collector const&) = delete;
+  Collector& operator=(Collector const&) = delete;
+
+  void Start();
+  void Stop();
+  // Asks for rows processes from first on in key order, a change is
+  // published right away from the last sample
+  void Request(SortKey key, std::size_t rows, std::size_t first = 0) override;
+  Snapshot const& Latest(bool* fresh = nullptr) override;
+  void Expand(int pid, bool expanded) override;
+  bool Filter(std::string const& query) override;
+  // Appends every sampled tick to the recorder, set before Start
+  void Record(Recorder* recorder);
+
+  // Samples one tick on the calling thread, for callers without a display
+  void Collect(Snapshot& snapshot, SortKey key, std::size_t rows,
+               std::size_t first = 0);
+
+ private:
+  // PIDs sampled in the first batch of the first tick, every further
+  // batch is twice as large
+  static constexpr std::size_t kFirstBatch{256};
+
+  void Run();
+  void Fill(Snapshot& snapshot, std::vector<Process*>& processes,
+            SortKey key, std::size_t rows, std::size_t first);
+
+  System& system_;
+  Recorder* recorder_{nullptr};
+  SelfMonitor self_;
+  std::chrono::milliseconds const period_;
+  SnapshotExchange exchange_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  SortKey key_{SortKey::kCpu};
+  std::size_t rows_{10};
+  std::size_t first_{0};
+  std::vector<int> expanded_;
+  bool expansion_changed_{false};
+  ProcessFilter filter_;
+  bool filter_changed_{false};
+  bool changed_{false};
+  bool stop_{false};
+  unsigned long tick_{0};
+};
+
+#endif
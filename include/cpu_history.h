@@ -0,0 +1,91 @@
+#ifndef CPU_HISTORY_H
+#define CPU_HISTORY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed capacity FIFO stored inline, full buffers drop their oldest entry
+template <typename T, std::size_t Capacity>
+class RingBuffer {
+ public:
+  // Appends a value, keeping at most limit entries
+  void Push(T const& value, std::size_t limit = Capacity) {
+    if (limit > Capacity) limit = Capacity;
+    while (size_ > 0 && size_ >= limit) {
+      head_ = (head_ + 1) % Capacity;
+      --size_;
+    }
+    items_[(head_ + size_) % Capacity] = value;
+    ++size_;
+  }
+  std::size_t Size() const { return size_; }
+  // The i-th entry from the oldest on
+  T& operator[](std::size_t i) { return items_[(head_ + i) % Capacity]; }
+  T const& Oldest() const { return items_[head_]; }
+  T const& Newest() const { return items_[(head_ + size_ - 1) % Capacity]; }
+  // The entry before the newest one, only valid for two or more entries
+  T const& Previous() const {
+    return items_[(head_ + size_ - 2) % Capacity];
+  }
+
+ private:
+  std::array<T, Capacity> items_{};
+  std::uint8_t head_{0};
+  std::uint8_t size_{0};
+};
+
+// Busy and total time of a CPU or process in clock ticks
+struct CpuTicks {
+  std::uint64_t busy{0};
+  std::uint64_t total{0};
+};
+
+// Clock ticks per second the kernel counts CPU times in
+long ClockTicks();
+// Counters of a process or thread started starttime clock ticks after boot
+// that has been busy for busy clock ticks, at the given system uptime
+CpuTicks TaskTicks(std::uint64_t busy, long starttime, double uptime);
+
+enum class UtilizationMode { kSlidingWindow, kEwma };
+
+struct CpuHistoryConfig {
+  UtilizationMode mode{UtilizationMode::kSlidingWindow};
+  // Number of ticks the sliding window spans
+  std::size_t window{10};
+  // Weight of the latest tick in the moving average
+  float alpha{0.3};
+};
+
+// Ticks the utilization looks back on: the window, or about 1 / alpha
+// ticks for the moving average, at most CpuHistory::kMaxWindow
+unsigned Horizon(CpuHistoryConfig const& config);
+
+/*
+History of CPU tick counters from which the utilization is computed,
+either as the average over a sliding window of ticks or as an
+exponentially weighted moving average of the utilization of every tick.
+The first sample gives the average since the counters started.
+*/
+class CpuHistory {
+ public:
+  static constexpr std::size_t kMaxWindow{15};
+  // carried is the number of latest samples that only carried the busy
+  // time of the one before them forward. The busy time that came in
+  // since is spread over them, as if it had been sampled every tick.
+  float Update(CpuTicks const& ticks, CpuHistoryConfig const& config,
+               std::size_t carried = 0);
+  float Utilization() const { return utilization_; }
+  // Number of samples the utilization is taken over
+  std::size_t Samples() const { return samples_.Size(); }
+  // The counters of the last update, only valid after the first one
+  CpuTicks const& Latest() const { return samples_.Newest(); }
+
+ private:
+  void Spread(CpuTicks const& ticks, std::size_t carried);
+
+  RingBuffer<CpuTicks, kMaxWindow + 1> samples_;
+  float utilization_{0.0};
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <atomic>
+#include <string>
+
+#include "collector.h"
+#include "options.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+
+/*
+Serves the latest snapshot in the Prometheus text exposition format over
+a local TCP or unix socket. Every snapshot is serialized into a complete
+HTTP response once, when the collector publishes it; a scrape only reads
+its request and gets that response with a single send, so scrapes never
+read procfs and any number of them share one sample.
+*/
+namespace Exporter {
+// Appends the metrics of a snapshot to out in the exposition format
+void Serialize(Snapshot const& snapshot, std::string& out);
+// Serves the snapshots of source to the scrapes on a listening socket
+// until stop is set or the socket fails, returns the exit code
+int Serve(int listener, SnapshotSource& source,
+          std::atomic<bool> const& stop);
+// Serves options.export_address until SIGINT, SIGTERM or a failing
+// socket, returns the exit code. Starts the collector.
+int Run(Collector& collector, Options const& options);
+};  // namespace Exporter
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FD_CACHE_H
+#define FD_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+Budget of the procfs files that are kept open from one tick to the next.
+The budget is taken from RLIMIT_NOFILE, leaving a quarter of the limit to
+the files every worker opens for a single read, the outputs and the
+terminal. Files are counted from any thread without a lock. Once the
+budget is used up no more files are kept: the processes holding one keep
+it until they exit, all others read by path, so the kept set stays the
+same from tick to tick instead of being closed and opened again.
+*/
+class FdCache {
+ public:
+  // A limit of 0 takes the budget from RLIMIT_NOFILE
+  explicit FdCache(std::size_t limit = 0);
+  // Takes one file from the budget, false if it is used up
+  bool Acquire();
+  void Release();
+  std::size_t Open() const;
+  std::size_t Limit() const;
+  bool Full() const;
+
+ private:
+  std::atomic<std::size_t> open_{0};
+  std::size_t const limit_;
+};
+
+/*
+A procfs file kept open and re-read from the start with pread, so that a
+sample costs neither building the path nor the open and close calls. The
+fd refers to the process that was opened, not to its PID: once that
+process is gone, reads fail and the file has to be opened again by path.
+*/
+class CachedFile {
+ public:
+  CachedFile() = default;
+  ~CachedFile();
+  CachedFile(CachedFile const&) = delete;
+  CachedFile& operator=(CachedFile const&) = delete;
+
+  // Opens the file counted against the cache, files without a cache are
+  // not counted. False if the budget is used up or the open failed.
+  bool Open(char const* path, FdCache* cache);
+  void Close();
+  bool IsOpen() const { return fd_ >= 0; }
+  int Fd() const { return fd_; }
+
+ private:
+  int fd_{-1};
+  FdCache* cache_{nullptr};
+};
+
+#endif
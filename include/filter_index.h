@@ -0,0 +1,84 @@
+#ifndef FILTER_INDEX_H
+#define FILTER_INDEX_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "process.h"
+
+/*
+A query over the processes, e.g. "user=www pid=100-2000 nginx". Words of
+the form user=NAME and pid=N or pid=FROM-TO restrict the user and the
+PIDs, all other words make up a substring of the command that is matched
+without regard to case. All parts have to match.
+*/
+struct ProcessFilter {
+  std::string user;
+  // Lower case, words are joined with single spaces
+  std::string command;
+  int pid_from{0};
+  int pid_to{INT_MAX};
+
+  // Returns false for a malformed PID range and leaves filter unchanged
+  static bool Parse(std::string_view query, ProcessFilter& filter);
+  bool Empty() const;
+  // Whether the filter looks at users or commands, not only PIDs
+  bool NeedsText() const;
+};
+
+/*
+Index of the processes by user, command trigrams and PID. It is changed
+only for processes that were added, removed or loaded again, so a query
+looks at the processes under its rarest trigram or its user and not at
+every process.
+
+Users and commands are only posted once a query asks for them, until
+then the index holds the PIDs and the processes are never resolved.
+Removing a process only retires its id, the postings that refer to it
+are dropped when there are more retired postings than live ones.
+*/
+class FilterIndex {
+ public:
+  // The process has to be loaded, a process added twice is replaced
+  void Add(Process& process);
+  void Remove(int pid);
+  // Appends the processes matching the filter to out. The first filter
+  // that needs text resolves every process, better done by the caller on
+  // all workers with Process::Resolve beforehand.
+  void Match(ProcessFilter const& filter, std::vector<Process*>& out);
+  bool IndexesText() const;
+
+ private:
+  struct Entry {
+    Process* process{nullptr};
+    std::string command;
+    uint32_t generation{0};
+    // Postings that refer to the entry
+    std::size_t postings{0};
+  };
+  struct Posting {
+    uint32_t id;
+    uint32_t generation;
+  };
+  bool Live(Posting posting) const;
+  void Post(uint32_t id);
+  void Compact();
+
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> free_;
+  std::unordered_map<int, uint32_t> ids_;
+  std::map<int, uint32_t> pids_;
+  std::unordered_map<uint32_t, std::vector<Posting>> trigrams_;
+  std::unordered_map<std::string, std::vector<Posting>> users_;
+  std::size_t postings_{0};
+  std::size_t retired_{0};
+  bool text_{false};
+};
+
+#endif
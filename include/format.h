@@ -6,6 +6,7 @@
 namespace Format {
 std::string ElapsedTime(long times);
 std::string TwoDigits(std::string const &timestr);
+std::string Megabytes(long kilobytes);
 };  // namespace Format
 
 #endif
\ No newline at end of file
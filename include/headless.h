@@ -0,0 +1,16 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "collector.h"
+#include "options.h"
+
+/*
+Streams the samples of the monitor without a terminal, one record per
+tick as NDJSON or one line per shown process as CSV, to stdout or a file
+*/
+namespace Headless {
+// Returns the exit code, non zero if the output could not be written
+int Run(Collector& collector, Options const& options);
+};  // namespace Headless
+
+#endif
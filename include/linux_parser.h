@@ -1,40 +1,52 @@
 #ifndef SYSTEM_PARSER_H
 #define SYSTEM_PARSER_H
 
-#include <fstream>
 #include <map>
-#include <regex>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "fd_cache.h"
+#include "system_snapshot.h"
 
 namespace LinuxParser {
 // Paths
-const std::string kProcDirectory{"/proc/"};
+// The proc directory defaults to /proc/ and can point to a copy of it,
+// it has to be set before any sampling starts
+std::string const &ProcDirectory();
+void SetProcDirectory(std::string const &directory);
+// The cgroup v2 hierarchy, by default /sys/fs/cgroup or its unified part
+// on hybrid hosts, empty if there is none
+std::string const &CgroupDirectory();
+void SetCgroupDirectory(std::string const &directory);
 const std::string kCmdlineFilename{"/cmdline"};
 const std::string kCpuinfoFilename{"/cpuinfo"};
 const std::string kStatusFilename{"/status"};
 const std::string kStatFilename{"/stat"};
+const std::string kStatmFilename{"/statm"};
+const std::string kCgroupFilename{"/cgroup"};
+const std::string kCgroupCpuFilename{"/cpu.stat"};
+const std::string kCgroupMemoryFilename{"/memory.current"};
+const std::string kSmapsRollupFilename{"/smaps_rollup"};
+const std::string kIoFilename{"/io"};
+const std::string kSelfDirectory{"/proc/self"};
+const std::string kTaskDirectory{"/task"};
 const std::string kUptimeFilename{"/uptime"};
 const std::string kMeminfoFilename{"/meminfo"};
 const std::string kVersionFilename{"/version"};
 const std::string kOSPath{"/etc/os-release"};
 const std::string kPasswordPath{"/etc/passwd"};
 
-// Helpers
-std::vector<std::string> GetLines(std::string const &filepath);
-std::vector<std::string> GetLineElements(std::string const &line,
-                                         char const &separator);
-std::vector<std::vector<std::string>> GetSpacedContent(
-    std::string const &filepath, char const &separator);
-std::map<std::string, std::string> GetKVContent(
-    std::string const &filepath, char const &separator,
-    std::vector<char> const &removechars);
-
 // System
-float MemoryUtilization();
-long UpTime();
-std::vector<int> Pids();
-int TotalProcesses();
-int RunningProcesses();
+// The system wide files, kept open for the life of the monitor
+struct SystemFiles {
+  CachedFile stat;
+  CachedFile meminfo;
+  CachedFile uptime;
+};
+void ReadSystemSnapshot(SystemSnapshot &snapshot,
+                        SystemFiles *files = nullptr);
+void Pids(std::vector<int> &pids);
 std::string OperatingSystem();
 std::string Kernel();
 
@@ -51,15 +63,64 @@ enum CPUStates {
   kGuest_,
   kGuestNice_
 };
-std::map<std::string, long> CpuUtilization();
 
 // Processes
+// Values of one process in one tick, the times are in clock ticks
+struct ProcessSample {
+  long utime{0};
+  long stime{0};
+  long cutime{0};
+  long cstime{0};
+  long starttime{0};
+  long rss_kb{0};
+};
+// Memory of a process that is expensive to read, in kB
+struct MemoryDetail {
+  long pss_kb{0};
+  long uss_kb{0};
+};
+// The files of a process read every sample, kept open within the budget
+// of the cache
+struct ProcessFiles {
+  CachedFile stat;
+  CachedFile statm;
+};
 std::string Command(int pid);
-std::string Ram(int pid);
-std::string Uid(int pid);
-std::string User(int pid);
-long int UpTime(int pid);
-std::map<std::string, float> CpuUtilization(int pid);
+int Uid(int pid);
+bool ReadProcessSample(int pid, ProcessSample &sample,
+                       ProcessFiles *files = nullptr, FdCache *cache = nullptr);
+bool ReadMemoryDetail(int pid, MemoryDetail &detail);
+
+// Cgroups
+// Accounting of one cgroup, memory is -1 without the memory controller
+struct CgroupSample {
+  long usage_usec{0};
+  long memory_kb{-1};
+};
+// Path of the cgroup v2 of a process relative to the hierarchy
+std::string Cgroup(int pid);
+bool ReadCgroupSample(std::string const &cgroup, CgroupSample &sample);
+
+// The monitor itself, always read from the live /proc/self
+// Its resident set and the read and write system calls it made so far,
+// which the kernel counts in /proc/self/io
+struct SelfSample {
+  long rss_kb{0};
+  long syscalls{0};
+};
+bool ReadSelfSample(SelfSample &sample);
+
+// Threads
+// Values of one thread in one tick, the name points into the read buffer
+// of the calling thread and is valid until its next parser call
+struct ThreadSample {
+  std::string_view name;
+  long utime{0};
+  long stime{0};
+  long starttime{0};
+};
+void Tids(int pid, std::vector<int> &tids);
+bool ReadThreadSample(int pid, int tid, ThreadSample &sample);
 
 };  // namespace LinuxParser
 
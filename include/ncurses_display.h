@@ -3,14 +3,26 @@
 
 #include <curses.h>
 
+#include <string_view>
+
 #include "process.h"
-#include "system.h"
+#include "screen_buffer.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
 
 namespace NCursesDisplay {
-void Display(System& system, int n = 10);
-void DisplaySystem(System& system, WINDOW* window);
-void DisplayProcesses(std::vector<Process>& processes, WINDOW* window, int n);
-std::string ProgressBar(float percent);
+// Shows the source until q is pressed, the process list fills the terminal
+void Display(SnapshotSource& source, SortKey key = SortKey::kCpu);
+void DisplaySystem(Snapshot const& snapshot, ScreenBuffer& screen);
+// Shows what the monitor costs in place of the system values
+void DisplayOverhead(Snapshot const& snapshot, ScreenBuffer& screen,
+                     long render_us);
+// The filter is shown next to the column headers if there is one
+int DisplayProcesses(Snapshot const& snapshot, ScreenBuffer& screen, int n,
+                     int selected = -1, std::string_view filter = {});
+void DisplayCgroups(Snapshot const& snapshot, ScreenBuffer& screen, int n);
+void ProgressBar(ScreenBuffer& screen, int row, int col, float percent);
+bool SortKeyFor(int input, SortKey& key);
 };  // namespace NCursesDisplay
 
 #endif
\ No newline at end of file
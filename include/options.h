@@ -0,0 +1,66 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "cpu_history.h"
+#include "process.h"
+
+enum class OutputFormat { kNdjson, kCsv };
+
+// Command line options of the monitor
+struct Options {
+  bool help{false};
+  // Number of worker threads sampling processes, 0 is one per core
+  unsigned threads{0};
+  // Directory procfs is read from, e.g. a synthetic copy of it
+  std::string proc_directory{"/proc/"};
+  // Directory of the cgroup v2 hierarchy, found on its own if empty
+  std::string cgroup_directory;
+  // How the CPU utilization of processes is averaged over the ticks
+  CpuHistoryConfig history;
+  // Most ticks between two samples of an idle process, 1 samples all.
+  // The CPU window or the horizon of the moving average bound it too.
+  unsigned idle_interval{16};
+  // Time between two samples
+  std::chrono::milliseconds interval{1000};
+  SortKey sort{SortKey::kCpu};
+  // Only processes matching this query are shown, see ProcessFilter
+  std::string filter;
+  // Follow process lifecycle events instead of scanning /proc every tick
+  bool proc_events{false};
+
+  // Stream samples instead of starting the display
+  bool headless{false};
+  OutputFormat format{OutputFormat::kNdjson};
+  // File the samples are written to, stdout if empty
+  std::string output;
+  // Number of processes per sample
+  std::size_t top{10};
+  // Number of samples to write, 0 streams until interrupted
+  unsigned long count{0};
+
+  // Serve the samples to scrapers on [HOST]:PORT or unix:PATH instead of
+  // starting the display
+  std::string export_address;
+
+  // Stream the samples to an aggregator on this address instead of
+  // starting the display
+  std::string agent_address;
+  // Show the processes of the agents streaming to this address
+  std::string aggregate_address;
+
+  // Recording the samples are appended to, none if empty
+  std::string record;
+  // Recording shown instead of the live system and its playback speed
+  std::string replay;
+  double replay_speed{1.0};
+};
+
+// Throws std::invalid_argument for unknown options or bad values
+Options ParseOptions(int argc, char* argv[]);
+std::string Usage(std::string const& program);
+
+#endif
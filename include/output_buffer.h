@@ -0,0 +1,46 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+/*
+Fixed size write buffer in front of a file descriptor. Numbers are
+formatted with to_chars straight into the buffer and the buffer is only
+written out when it is full or flushed, so appending never allocates.
+*/
+class OutputBuffer {
+ public:
+  explicit OutputBuffer(int fd);
+  ~OutputBuffer();
+  OutputBuffer(OutputBuffer const&) = delete;
+  OutputBuffer& operator=(OutputBuffer const&) = delete;
+
+  void Append(std::string_view text);
+  void Append(char c);
+  void Append(long number);
+  // Appends a number with the given number of decimals
+  void Append(double number, int decimals);
+  // Appends text as a quoted JSON string
+  void AppendJson(std::string_view text);
+  // Appends text as a CSV field, quoted only if it has to be
+  void AppendCsv(std::string_view text);
+  // Returns false once a write failed, e.g. because the reader went away
+  bool Flush();
+
+ private:
+  static constexpr std::size_t kNumberSize{32};
+  char* Reserve(std::size_t size);
+
+  int const fd_;
+  std::array<char, 65536> buffer_;
+  std::size_t size_{0};
+  bool failed_{false};
+};
+
+// The length of the valid UTF-8 sequence text starts with, 0 if it does
+// not start with one
+std::size_t Utf8Length(std::string_view text);
+
+#endif
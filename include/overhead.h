@@ -0,0 +1,50 @@
+#ifndef OVERHEAD_H
+#define OVERHEAD_H
+
+#include <chrono>
+
+// Microseconds the last tick spent in each of its phases
+struct PhaseTimes {
+  long scan_us{0};
+  long sample_us{0};
+  long sort_us{0};
+};
+
+// Times consecutive phases. The steady clock is read through the vDSO,
+// so a lap costs no system call.
+class PhaseTimer {
+ public:
+  PhaseTimer();
+  // Microseconds since the last lap or since the timer started
+  long Lap();
+
+ private:
+  std::chrono::steady_clock::time_point last_;
+};
+
+// What the monitor itself used in the last tick, -1 where unknown
+struct SelfUsage {
+  // CPU time of all its threads as a share of one CPU
+  float cpu{-1};
+  long rss_kb{-1};
+  // Read and write system calls
+  long syscalls{-1};
+};
+
+/*
+Measures the resources of the monitor between two updates: its CPU time
+through getrusage, its resident set and system calls through /proc/self.
+*/
+class SelfMonitor {
+ public:
+  SelfUsage const& Update();
+  SelfUsage const& Usage() const { return usage_; }
+
+ private:
+  SelfUsage usage_;
+  std::chrono::steady_clock::time_point last_time_;
+  long last_cpu_us_{-1};
+  long last_syscalls_{-1};
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef PID_SOURCE_H
+#define PID_SOURCE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "process_table.h"
+
+/*
+Source of the PIDs on the system for every tick. With the netlink proc
+connector the set is kept up to date from fork, exec and exit events, so
+a tick only drains the events since the last one and also learns about
+processes that came and went in between. Subscribing needs CAP_NET_ADMIN
+in the initial user namespace; without it, or when the listener falls
+behind, /proc is scanned instead. A scan every few ticks also catches
+events that got lost without the listener noticing.
+*/
+class PidSource {
+ public:
+  // Listening is only attempted if asked for, otherwise every tick scans
+  explicit PidSource(bool listen = false);
+  ~PidSource();
+  PidSource(PidSource const&) = delete;
+  PidSource& operator=(PidSource const&) = delete;
+
+  // The PIDs of this tick, valid until the next call
+  std::vector<int> const& Pids();
+  // PIDs that ran exec since the previous tick, their command changed
+  std::vector<int> const& Execs() const;
+  // Processes started and gone since the previous tick, -1 without events
+  int ShortLived() const;
+  bool Listening() const;
+
+ private:
+  bool Subscribe();
+  bool AwaitAck();
+  void Unsubscribe();
+  bool Drain();
+  void Scan();
+  void Add(int pid);
+  void Remove(int pid);
+
+  int socket_{-1};
+  // The PIDs in no particular order. While listening the index maps them
+  // to positions.
+  std::vector<int> pids_;
+  // Generation of the tick a PID was first seen in, parallel to pids_
+  // while listening
+  std::vector<uint32_t> born_;
+  PidIndex index_;
+  std::vector<int> execs_;
+  uint32_t generation_{0};
+  int short_lived_{0};
+};
+
+#endif
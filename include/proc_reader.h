@@ -0,0 +1,62 @@
+#ifndef PROC_READER_H
+#define PROC_READER_H
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/*
+Reader for procfs files. Every file is pulled in with a single read() into
+a buffer that is kept between calls, and its content is handed out as a
+string_view so that it can be tokenized without any allocation.
+*/
+class ProcReader {
+ public:
+  ProcReader();
+  // Reads the whole file, returns false if it could not be opened or read
+  bool Read(const char* path);
+  // Reads the whole file behind an open fd from its start with pread
+  bool Read(int fd);
+  std::string_view Content() const;
+
+ private:
+  std::vector<char> buffer_;
+  std::size_t size_{0};
+};
+
+// Converts a token to a number, returns false if the token is not a number
+template <typename T>
+bool ParseNumber(std::string_view token, T& value) {
+  std::from_chars_result result =
+      std::from_chars(token.data(), token.data() + token.size(), value);
+  return result.ec == std::errc();
+}
+
+/*
+Cursor over a string_view that splits it into lines and tokens.
+Consecutive separators are treated as one and a ' ' separator matches any
+whitespace, which is how the fields of most procfs files are laid out.
+*/
+class Tokenizer {
+ public:
+  explicit Tokenizer(std::string_view text);
+  bool NextLine(std::string_view& line);
+  bool NextToken(std::string_view& token, char separator = ' ');
+  bool Skip(int count, char separator = ' ');
+  std::string_view Rest() const;
+
+  template <typename T>
+  bool NextNumber(T& value, char separator = ' ') {
+    std::string_view token;
+    return NextToken(token, separator) && ParseNumber(token, value);
+  }
+
+ private:
+  std::string_view rest_;
+};
+
+// Returns the rest of the first line starting with key, or an empty view
+std::string_view FindLine(std::string_view content, std::string_view key);
+
+#endif
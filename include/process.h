@@ -1,9 +1,20 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-#include <map>
-#include <queue>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+
+#include "cpu_history.h"
+#include "fd_cache.h"
+#include "linux_parser.h"
+#include "thread_table.h"
+#include "user_cache.h"
+
+// Columns the process list can be ordered by
+enum class SortKey { kCpu, kMemory, kPid, kUptime, kUser };
+
 /*
 Basic class for Process representation
 It contains relevant attributes as shown below
@@ -11,29 +22,79 @@ It contains relevant attributes as shown below
 class Process {
  public:
   Process(int pid);
-  void MarkStale();
-  static bool GetStale(const Process& proc);
+  void Load(UserCache& users);
   int Pid();
-  std::string User();
-  std::string Command();
+  // The user and the command are only read when first asked for, so the
+  // processes that are never shown cost no reads for them
+  std::string const& User();
+  std::string const& Command();
+  // Reads both if they were not read yet, e.g. on a worker thread
+  void Resolve();
+  // Path of the cgroup the process was in when loaded, empty if unknown
+  std::string const& Cgroup();
+  // ID of the cgroup in the cgroup table, UINT32_MAX for none
+  void SetCgroupId(std::uint32_t id);
+  std::uint32_t CgroupId();
   float CpuUtilization();
-  void UpdateUtilization();
+  // Until the second sample, the utilization is the average since the
+  // process started and not that of the last ticks
+  bool Warming();
+  // carried counts the ticks since the last sample, see CpuHistory
+  bool UpdateUtilization(double uptime, CpuHistoryConfig const& config,
+                         FdCache* files = nullptr, std::size_t carried = 0);
+  // Samples the process if it is due in this tick, returns whether it was.
+  // Its files are kept open as far as the cache has room for them.
+  bool Update(unsigned long tick, double uptime,
+              CpuHistoryConfig const& config, unsigned max_interval,
+              FdCache* files = nullptr);
+  // The PID was taken by a new process since the last sample, it has to
+  // be loaded again
+  bool Restarted();
+  // Tick of the last sample
+  unsigned long LastSample();
+  // Samples the process in the next tick whether it is idle or not, for
+  // the processes on screen
+  void Watch();
+  // Starts or stops keeping the threads of the process
+  void Expand(bool expanded);
+  // The threads of an expanded process, nullptr for all others
+  ThreadTable* Threads();
   std::string Ram();
+  long RamKb();
+  // Proportional and unique set size, -1 until read or if unreadable
+  void UpdateMemoryDetail(unsigned long tick);
+  long PssKb();
+  long UssKb();
   long int UpTime();
   bool operator<(Process const& a) const;
+  // Orders by the given column, ties are broken by PID
+  static bool Before(Process const& a, Process const& b, SortKey key);
 
   // DONE: Declare any necessary private members
  private:
   int pid_;
   std::string command_;
   std::string user_;
-  std::string uid_;
+  UserCache* users_{nullptr};
+  bool command_read_{false};
+  bool user_read_{false};
+  std::string cgroup_;
+  std::uint32_t cgroup_id_{UINT32_MAX};
   long upsinceboot_;
-  float current_cpu_;
-  std::string current_ram_;
-  std::queue<std::map<std::string, float>> prev_stats_;
-  long unsigned int procqueuedepth_;
-  bool stale_;
+  double uptime_;
+  long current_ram_kb_;
+  CpuHistory history_;
+  // Start of the process in clock ticks after boot
+  long starttime_{0};
+  // Tick the process is sampled next in and the ticks between samples
+  unsigned long next_sample_{0};
+  unsigned interval_{1};
+  bool restarted_{false};
+  LinuxParser::ProcessFiles files_;
+  std::unique_ptr<ThreadTable> threads_;
+  long pss_kb_{-1};
+  long uss_kb_{-1};
+  unsigned long detail_tick_{0};
 };
 
 #endif
\ No newline at end of file
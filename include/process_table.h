@@ -0,0 +1,68 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "process.h"
+
+/*
+Open addressing hash from PID to the slot of its process. Collisions are
+resolved by linear probing and erasing shifts the following entries back,
+so lookups never have to step over tombstones.
+*/
+class PidIndex {
+ public:
+  static constexpr uint32_t kNotFound = UINT32_MAX;
+  PidIndex();
+  uint32_t Find(int pid) const;
+  void Insert(int pid, uint32_t slot);
+  void Erase(int pid);
+
+ private:
+  struct Entry {
+    int pid;
+    uint32_t slot;
+  };
+  size_t Bucket(int pid) const;
+  void Grow();
+
+  std::vector<Entry> entries_;
+  size_t mask_;
+  int shift_;
+  size_t size_{0};
+};
+
+/*
+Table of the processes on the system. Every Process is constructed in
+place in a slot that never moves, slots of vanished processes are reused
+and a PidIndex maps PIDs to slots, so reconciling the table with the
+PIDs of a tick is O(N) and never copies a Process.
+*/
+class ProcessTable {
+ public:
+  // Adds processes for new PIDs and releases the ones that are gone
+  void Reconcile(std::vector<int> const& pids);
+  Process* Find(int pid);
+  // The live processes in slot order, valid until the next Reconcile
+  std::vector<Process*>& Processes();
+  // The processes added by the last Reconcile and the PIDs it released
+  std::vector<Process*>& Added();
+  std::vector<int>& Removed();
+
+ private:
+  uint32_t Allocate();
+
+  PidIndex index_;
+  std::deque<std::optional<Process>> slots_;
+  std::vector<uint32_t> seen_;
+  std::vector<uint32_t> free_;
+  std::vector<Process*> live_;
+  std::vector<Process*> added_;
+  std::vector<int> removed_;
+  uint32_t generation_{0};
+};
+
+#endif
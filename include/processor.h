@@ -1,18 +1,20 @@
 #ifndef PROCESSOR_H
 #define PROCESSOR_H
 
-#include <map>
-#include <queue>
-#include <string>
+#include "cpu_history.h"
+#include "system_snapshot.h"
 
 class Processor {
  public:
+  Processor(CpuHistoryConfig const& config = {UtilizationMode::kSlidingWindow,
+                                              3, 0.3});
+  void Update(CpuTimes const& cputimes);
   float Utilization();  // DONE: See src/processor.cpp
 
   // DONE: Declare any necessary private members
  private:
-  std::queue<std::map<std::string, long>> prev_stats_;
-  const long unsigned int timedistance_{3};
+  CpuHistoryConfig config_;
+  CpuHistory history_;
 };
 
-#endif
\ No newline at end of file
+#endif
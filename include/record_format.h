@@ -0,0 +1,81 @@
+#ifndef RECORD_FORMAT_H
+#define RECORD_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+Binary format of a recorded session. A recording starts with kMagic and
+is followed by frames, each a varint payload length, a type byte and the
+payload. Frames only refer to state set up by earlier frames, so a file
+can be appended to tick by tick and a reader stops cleanly at a frame cut
+off by a crash.
+
+kHost:   os, kernel and host name as length prefixed strings, the host
+         name is missing in recordings of older versions
+kString: the next interned string, ids count up from 0 in file order
+kTick:   the system values followed by the processes that changed:
+         time_ms delta, cpu and memory in 1/10000, total processes delta,
+         running processes, short lived + 1, uptime delta,
+         removed count and the removed PIDs as deltas,
+         changed count and per process its PID delta, a field mask and
+         the fields in the mask: cpu in 1/10000, ram_kb delta, start
+         delta, user id and command id
+
+Deltas are zigzag encoded, all integers are LEB128 varints and PIDs are
+in ascending order, so a tick of idle processes costs nothing but its
+header.
+*/
+namespace RecordFormat {
+constexpr std::string_view kMagic{"MONREC1\n"};
+
+enum FrameType : uint8_t { kHost = 1, kString = 2, kTick = 3 };
+
+// Fields of a process entry in a tick frame
+enum Field : uint8_t {
+  kCpu = 1 << 0,
+  kRam = 1 << 1,
+  kStart = 1 << 2,
+  kUser = 1 << 3,
+  kCommand = 1 << 4,
+  kAllFields = kCpu | kRam | kStart | kUser | kCommand
+};
+
+// Fixed point of the utilization values
+constexpr float kUnit{10000.0};
+
+void PutVarint(std::string& out, uint64_t value);
+void PutSigned(std::string& out, int64_t value);
+void PutString(std::string& out, std::string_view text);
+
+/*
+Cursor over the payload of a frame. Every read checks the bounds, a
+failed read leaves the reader failed and all later reads fail too.
+*/
+class Reader {
+ public:
+  Reader(char const* begin, char const* end);
+  bool Varint(uint64_t& value);
+  bool Signed(int64_t& value);
+  bool Byte(uint8_t& value);
+  bool String(std::string_view& text);
+  bool Failed() const;
+  // Bytes left up to the end
+  std::size_t Remaining() const;
+  char const* Position() const;
+
+ private:
+  char const* position_;
+  char const* end_;
+  bool failed_{false};
+};
+
+// Locates the frame at offset and the offset of the frame after it, fails
+// for a frame cut off at the end
+bool FrameAt(char const* data, std::size_t size, std::size_t offset,
+             uint8_t& type, Reader& payload, std::size_t& next);
+}  // namespace RecordFormat
+
+#endif
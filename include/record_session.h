@@ -0,0 +1,93 @@
+#ifndef RECORD_SESSION_H
+#define RECORD_SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "process.h"
+#include "record_format.h"
+#include "snapshot.h"
+
+/*
+The state a stream in the RecordFormat builds up frame by frame: the
+host, the interned strings, the processes as of the last tick and the
+system values of that tick. A recording and the stream of an agent are
+decoded alike.
+*/
+class RecordSession {
+ public:
+  struct Entry {
+    int pid{0};
+    uint32_t cpu{0};
+    long ram_kb{0};
+    long start{0};
+    uint32_t user{0};
+    uint32_t command{0};
+  };
+
+  // Applies one frame, returns false if it is malformed. Frames of an
+  // unknown type are skipped.
+  bool Apply(uint8_t type, RecordFormat::Reader payload);
+
+  std::string const& Os() const;
+  std::string const& Kernel() const;
+  // The host name of the stream, the owner may rename it
+  std::string const& Host() const;
+  void Rename(std::string const& host);
+  std::string const& String(uint32_t id) const;
+  std::unordered_map<int, Entry> const& Processes() const;
+
+  // The values of the last applied tick frame
+  long TimeMs() const;
+  unsigned long Ticks() const;
+  float Cpu() const;
+  float Memory() const;
+  long TotalProcesses() const;
+  int RunningProcesses() const;
+  int ShortLived() const;
+  long UpTime() const;
+
+ private:
+  bool ApplyTick(RecordFormat::Reader& payload);
+
+  std::string os_;
+  std::string kernel_;
+  std::string host_;
+  std::vector<std::string> strings_;
+  std::unordered_map<int, Entry> processes_;
+
+  long time_ms_{0};
+  unsigned long ticks_{0};
+  float cpu_{0.0};
+  float memory_{0.0};
+  long total_processes_{0};
+  int running_processes_{0};
+  int short_lived_{-1};
+  long uptime_{0};
+};
+
+/*
+Orders the processes of one or more sessions into the rows of a snapshot
+like System::Order does for the live system. The system values of several
+sessions are added up, utilizations are averaged over the hosts.
+*/
+class SessionMerger {
+ public:
+  // Fills rows processes from first on, labelled with the host of their
+  // session if hosts is set
+  void Fill(std::vector<RecordSession const*> const& sessions, SortKey key,
+            std::size_t rows, std::size_t first, bool hosts,
+            Snapshot& snapshot);
+
+ private:
+  struct Ref {
+    RecordSession const* session;
+    RecordSession::Entry const* entry;
+  };
+  std::vector<Ref> order_;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "output_buffer.h"
+#include "process.h"
+#include "system.h"
+
+/*
+Appends every sampled tick to a recording in the RecordFormat. The values
+last written for each PID are kept, so a tick only carries the processes
+that changed since the previous one, and users and commands are written
+once and referred to by id afterwards. The same stream is sent by agents
+to an aggregator.
+*/
+class Recorder {
+ public:
+  Recorder() = default;
+  ~Recorder();
+  Recorder(Recorder const&) = delete;
+  Recorder& operator=(Recorder const&) = delete;
+
+  // Creates or truncates the file, returns false if it cannot be opened
+  bool Open(std::string const& path);
+  // Starts a new recording on fd, e.g. a connected socket, and takes it
+  // over. Everything written before is forgotten.
+  void Attach(int fd);
+  // Writes one tick, returns false once writing the file failed
+  bool Write(System& system, std::vector<Process*>& processes);
+  bool Failed() const;
+
+ private:
+  struct Entry {
+    uint32_t cpu{0};
+    long ram_kb{0};
+    long start{0};
+    uint32_t user{0};
+    uint32_t command{0};
+    uint32_t generation{0};
+  };
+  // The fields of a process that changed, with deltas for the counters
+  struct Change {
+    int pid;
+    uint8_t mask;
+    uint32_t cpu;
+    long ram_kb;
+    long start;
+    uint32_t user;
+    uint32_t command;
+  };
+  uint32_t Intern(std::string const& text);
+  void Frame(uint8_t type, std::string_view payload);
+
+  int fd_{-1};
+  std::optional<OutputBuffer> out_;
+  bool failed_{false};
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::vector<std::string const*> strings_;
+  std::unordered_map<int, Entry> processes_;
+  uint32_t generation_{0};
+  std::vector<Change> changes_;
+  std::vector<int> removed_;
+  std::string payload_;
+  std::string frame_;
+  // The values of the previous tick frame
+  long time_ms_{0};
+  long total_processes_{0};
+  long uptime_{0};
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef REPLAYER_H
+#define REPLAYER_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "process.h"
+#include "record_session.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+
+/*
+Plays a recording back as snapshots for the display. The file is mapped
+into memory and decoded tick by tick as the replay clock reaches the time
+a tick was recorded at, scaled by the speed. After the last tick the
+final state stays on screen.
+*/
+class Replayer : public SnapshotSource {
+ public:
+  explicit Replayer(double speed = 1.0);
+  ~Replayer();
+  Replayer(Replayer const&) = delete;
+  Replayer& operator=(Replayer const&) = delete;
+
+  // Maps the file, returns false if it cannot be read or is no recording
+  bool Open(std::string const& path);
+  void Request(SortKey key, std::size_t rows, std::size_t first = 0) override;
+  Snapshot const& Latest(bool* fresh = nullptr) override;
+
+ private:
+  bool NextTime(long& time_ms);
+  bool ApplyTick();
+
+  double const speed_;
+  char const* data_{nullptr};
+  std::size_t size_{0};
+  // Start of the next frame that has not been applied
+  std::size_t offset_{0};
+  bool ended_{false};
+  RecordSession session_;
+  SessionMerger merger_;
+
+  std::chrono::steady_clock::time_point started_;
+  long first_time_ms_{0};
+  SortKey key_{SortKey::kCpu};
+  std::size_t rows_{10};
+  std::size_t first_{0};
+  bool changed_{true};
+  Snapshot snapshot_;
+};
+
+#endif
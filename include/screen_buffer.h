@@ -0,0 +1,37 @@
+#ifndef SCREEN_BUFFER_H
+#define SCREEN_BUFFER_H
+
+#include <curses.h>
+
+#include <string_view>
+#include <vector>
+
+/*
+Character grid of the inside of a boxed window that keeps the previous
+frame. A frame is composed with Put calls in window coordinates and
+Flush hands only the runs of cells that changed since the last frame to
+curses, so unchanged rows and fields cost no terminal output at all.
+*/
+class ScreenBuffer {
+ public:
+  // Sizes the grid for a window, the next Flush redraws every cell
+  void Resize(int rows, int cols);
+  // Starts a new frame with all cells blank
+  void Clear();
+  // Text past the border of the window is cut off
+  void Put(int row, int col, std::string_view text, attr_t attr = A_NORMAL);
+  void Put(int row, int col, char c, attr_t attr = A_NORMAL);
+  // Adds attr to every cell of a row, e.g. to mark a selection
+  void Highlight(int row, attr_t attr);
+  // Writes the changed cells into the window, returns how many changed
+  int Flush(WINDOW* window);
+
+ private:
+  int rows_{0};
+  int cols_{0};
+  std::vector<chtype> current_;
+  std::vector<chtype> previous_;
+  bool redraw_{true};
+};
+
+#endif
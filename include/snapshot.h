@@ -0,0 +1,107 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "overhead.h"
+#include "process.h"
+
+// A thread of an expanded process
+struct ThreadRow {
+  int tid{0};
+  float cpu{0.0};
+  std::string name;
+};
+
+// One row of the process list with the values as they are shown
+struct ProcessRow {
+  int pid{0};
+  float cpu{0.0};
+  // The process was sampled once, its CPU is not that of the last ticks
+  bool warming{false};
+  // Resident, proportional and unique set size, -1 if unknown
+  long ram_kb{0};
+  long pss_kb{-1};
+  long uss_kb{-1};
+  long uptime{0};
+  std::string user;
+  std::string command;
+  // Host the process runs on, only set for snapshots of several hosts
+  std::string host;
+  // The hottest threads first, only filled for expanded processes
+  bool expanded{false};
+  std::vector<ThreadRow> threads;
+};
+
+// A cgroup with the processes it held in this tick
+struct CgroupRow {
+  std::string path;
+  int processes{0};
+  float cpu{0.0};
+  // Memory charged to the cgroup, -1 if unknown
+  long memory_kb{-1};
+};
+
+/*
+Everything the display shows for one tick. A snapshot is filled by the
+collector and never changed once it has been published.
+*/
+struct Snapshot {
+  // Counts the snapshots published, a reorder publishes one too
+  unsigned long tick{0};
+  // Ticks the processes were sampled in full so far
+  unsigned long samples{0};
+  std::string os;
+  std::string kernel;
+  float cpu{0.0};
+  float memory{0.0};
+  int total_processes{0};
+  int running_processes{0};
+  // Processes that came and went between two samples, -1 if unknown
+  int short_lived{-1};
+  long uptime{0};
+  // The rows are the processes in key order from the first-th on, out of
+  // process_count
+  SortKey key{SortKey::kCpu};
+  std::size_t first{0};
+  std::size_t process_count{0};
+  std::vector<ProcessRow> rows;
+  // Whether the rows come from several hosts and carry their host
+  bool hosts{false};
+  // The first populated cgroups in key order, as many as there are rows
+  std::vector<CgroupRow> cgroups;
+  // The cost of the tick to the monitor itself
+  PhaseTimes phases;
+  SelfUsage self;
+};
+
+/*
+Triple buffer handing snapshots from one writer to one reader without
+locks. The writer fills the back buffer and swaps it with the middle one
+on publish; the reader swaps the middle buffer with its front buffer when
+a fresh one is there. Neither side ever waits for the other, and buffers
+are reused so their strings and rows keep their capacity.
+*/
+class SnapshotExchange {
+ public:
+  // Writer side
+  Snapshot& Back();
+  void Publish();
+  // Reader side, fresh tells whether a new snapshot was picked up
+  Snapshot const& Latest(bool* fresh = nullptr);
+
+ private:
+  static constexpr std::uint8_t kIndex{3};
+  static constexpr std::uint8_t kFresh{4};
+  std::array<Snapshot, 3> buffers_;
+  std::atomic<std::uint8_t> middle_{1};
+  std::uint8_t back_{0};
+  std::uint8_t front_{2};
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SNAPSHOT_SOURCE_H
+#define SNAPSHOT_SOURCE_H
+
+#include <cstddef>
+#include <string>
+
+#include "process.h"
+#include "snapshot.h"
+
+/*
+Where the display takes its snapshots from, the live system or a
+recording of it. Both calls come from the display thread.
+*/
+class SnapshotSource {
+ public:
+  virtual ~SnapshotSource() = default;
+  // Asks for rows processes from the first-th on in key order, e.g. the
+  // part of the list scrolled into view
+  virtual void Request(SortKey key, std::size_t rows,
+                       std::size_t first = 0) = 0;
+  // fresh tells whether the snapshot changed since the last call
+  virtual Snapshot const& Latest(bool* fresh = nullptr) = 0;
+  // Shows the threads of a process or stops doing so, sources without
+  // threads ignore it
+  virtual void Expand(int /*pid*/, bool /*expanded*/) {}
+  // Only shows the processes matching a ProcessFilter query, malformed
+  // queries are ignored. Returns false for sources that cannot filter.
+  virtual bool Filter(std::string const& /*query*/) { return false; }
+};
+
+#endif
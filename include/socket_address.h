@@ -0,0 +1,24 @@
+#ifndef SOCKET_ADDRESS_H
+#define SOCKET_ADDRESS_H
+
+#include <string>
+
+// A local stream socket, unix:PATH or [HOST]:PORT over TCP
+struct SocketAddress {
+  bool unix_socket{false};
+  std::string host;
+  std::string port;
+  std::string path;
+};
+
+namespace Socket {
+// An empty HOST is the loopback address, returns false for a bad address
+bool ParseAddress(std::string const& text, SocketAddress& address);
+// Return a non-blocking listening or a connected socket, -1 with errno set
+// on failure. Listening on unix:PATH replaces a stale socket at PATH but
+// no other kind of file.
+int Listen(SocketAddress const& address);
+int Connect(SocketAddress const& address);
+};  // namespace Socket
+
+#endif
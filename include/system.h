@@ -1,28 +1,100 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
+#include "cgroup_table.h"
+#include "cpu_history.h"
+#include "fd_cache.h"
+#include "filter_index.h"
+#include "linux_parser.h"
+#include "options.h"
+#include "overhead.h"
+#include "pid_source.h"
 #include "process.h"
+#include "process_table.h"
 #include "processor.h"
+#include "system_snapshot.h"
+#include "user_cache.h"
+#include "worker_pool.h"
 
 class System {
  public:
-  System();
+  explicit System(Options const& options = {});
+  void Refresh();
   Processor& Cpu();
-  std::vector<Process>& Processes();
+  static constexpr std::size_t kAllProcesses{SIZE_MAX};
+  // Samples the processes of this tick, the n from first on are ordered
+  // by key
+  std::vector<Process*>& Processes(SortKey key = SortKey::kCpu,
+                                   std::size_t n = kAllProcesses,
+                                   std::size_t first = 0);
+  // Samples the first tick batch PIDs at a time, so the processes read so
+  // far can be ordered and shown before all are. Returns true once every
+  // process of the tick was sampled, from then on Processes samples the
+  // ticks that follow.
+  bool Warm(std::size_t batch);
+  // Samples the threads of these processes too, all others are collapsed
+  void Expand(std::vector<int> const& pids);
+  // Orders the processes of the last tick again without sampling them
+  std::vector<Process*>& Order(SortKey key, std::size_t n = kAllProcesses,
+                               std::size_t first = 0);
+  // Only the processes that match the filter are ordered from now on,
+  // including those of the last tick
+  void Filter(ProcessFilter const& filter);
+  // Every process of the last tick, matching the filter or not
+  std::vector<Process*>& AllProcesses();
+  // Reads the users and commands of these processes on all workers
+  void Resolve(std::vector<Process*>& processes);
+  // The first n cgroups with processes in them, ordered by key
+  std::vector<ControlGroup const*> const& Cgroups(SortKey key, std::size_t n);
   float MemoryUtilization();
   long UpTime();
   int TotalProcesses();
   int RunningProcesses();
-  std::string Kernel();
-  std::string OperatingSystem();
+  // Ticks sampled in full so far, a first tick still warming up is not
+  unsigned long Samples();
+  // Number of processes read from procfs in the last tick
+  std::size_t SampledProcesses();
+  // Time the last tick took to scan, sample and order the processes
+  PhaseTimes const& Phases();
+  // Processes that started and exited within the last tick, -1 if unknown
+  int ShortLivedProcesses();
+  std::string const& Kernel();
+  std::string const& OperatingSystem();
 
   // DONE: Define any necessary private members
  private:
+  void Sample(std::vector<int> const& pids, bool all);
+  void FinishTick();
+  void SampleThreads(Process& process);
+  void Reload(Process& process);
+  void Select();
+
   Processor cpu_ = {};
-  std::vector<Process> processes_ = {};
+  PidSource pids_;
+  // The cache outlives the processes that hold files counted against it
+  FdCache files_;
+  LinuxParser::SystemFiles system_files_;
+  ProcessTable processes_;
+  FilterIndex index_;
+  ProcessFilter filter_;
+  std::vector<Process*> sorted_ = {};
+  std::vector<int> expanded_;
+  // The PIDs of the first tick and how many of them were sampled
+  std::vector<int> warming_;
+  std::size_t warmed_{0};
+  CgroupTable cgroups_;
+  SystemSnapshot snapshot_ = {};
+  UserCache users_;
+  WorkerPool pool_;
+  CpuHistoryConfig const history_;
+  unsigned const idle_interval_;
+  unsigned long tick_{0};
+  std::size_t sampled_{0};
+  PhaseTimes phases_;
   std::string const kernel_;
   std::string const osname_;
 };
@@ -0,0 +1,29 @@
+#ifndef SYSTEM_SNAPSHOT_H
+#define SYSTEM_SNAPSHOT_H
+
+// Aggregated CPU time counters from the cpu line of /proc/stat in ticks
+struct CpuTimes {
+  long idle{0};
+  long nonidle{0};
+  long total{0};
+};
+
+/*
+System wide values of one tick, built from a single read of each of
+/proc/stat, /proc/meminfo and /proc/uptime
+*/
+struct SystemSnapshot {
+  CpuTimes cpu;
+  int total_processes{0};
+  int running_processes{0};
+  long mem_total_kb{0};
+  long mem_available_kb{0};
+  double uptime{0.0};
+
+  float MemoryUtilization() const {
+    if (mem_total_kb == 0) return 0.0;
+    return float(mem_total_kb - mem_available_kb) / mem_total_kb;
+  }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef THREAD_TABLE_H
+#define THREAD_TABLE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "cpu_history.h"
+
+// One thread of a process with the history of its CPU times
+struct Thread {
+  int tid{0};
+  std::string name;
+  long starttime{0};
+  CpuHistory history;
+};
+
+/*
+The threads of one process. A process only gets a table while it is
+expanded, so threads are neither listed nor read for any other process.
+Threads are kept in TID order and keep their history from tick to tick,
+the same way processes do.
+*/
+class ThreadTable {
+ public:
+  explicit ThreadTable(int pid);
+  // Lists the threads of the process, new ones start with an empty history
+  void Enumerate();
+  std::size_t Size() const;
+  // Samples the i-th thread, threads can be sampled in parallel
+  void Sample(std::size_t i, double uptime, CpuHistoryConfig const& config);
+  // The threads ordered by CPU utilization, valid until the next Enumerate
+  std::vector<Thread const*> const& Hottest();
+
+ private:
+  int const pid_;
+  std::vector<Thread> threads_;
+  std::vector<int> tids_;
+  std::vector<Thread const*> order_;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <sys/types.h>
+
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+Cache of user names keyed by numeric UID, shared by all processes.
+It is filled from /etc/passwd and dropped whenever the file's mtime
+changes. UIDs that are not in the file (e.g. LDAP users) are resolved
+once through getpwuid_r and cached as well, unless the lookup failed.
+*/
+class UserCache {
+ public:
+  // An empty path reads /etc/passwd
+  explicit UserCache(std::string passwd = "");
+  // Checks the passwd mtime, meant to be called once per tick
+  void Revalidate();
+  std::string Name(uid_t uid);
+
+ private:
+  void Load();
+
+  std::string const passwd_;
+  std::mutex mutex_;
+  std::unordered_map<uid_t, std::string> names_;
+  timespec mtime_{0, 0};
+  bool loaded_{false};
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Pool of worker threads that runs parallel loops over an index range.
+Every worker starts on its own share of the range and steals chunks from
+the shares of the others once it is done, so a few slow items do not
+hold up the whole loop. The calling thread takes part as worker 0.
+*/
+class WorkerPool {
+ public:
+  // 0 workers means one per hardware thread
+  explicit WorkerPool(unsigned workers = 0);
+  ~WorkerPool();
+  WorkerPool(WorkerPool const&) = delete;
+  WorkerPool& operator=(WorkerPool const&) = delete;
+
+  unsigned Workers() const;
+
+  // Calls body(i) for every i in [0, count) and returns once all are done.
+  // body(i, worker) gets the index of the worker running it as well.
+  template <typename Body>
+  void ParallelFor(size_t count, Body&& body) {
+    Run(count, &body, [](void* context, size_t index, unsigned worker) {
+      Invoke(*static_cast<Body*>(context), index, worker);
+    });
+  }
+
+ private:
+  using Task = void (*)(void* context, size_t index, unsigned worker);
+
+  // The share of the index range of one worker, on its own cache line
+  struct alignas(64) Share {
+    std::atomic<size_t> next{0};
+    size_t end{0};
+  };
+
+  template <typename Body>
+  static auto Invoke(Body& body, size_t index, unsigned worker)
+      -> decltype(body(index, worker), void()) {
+    body(index, worker);
+  }
+  template <typename Body>
+  static auto Invoke(Body& body, size_t index, unsigned)
+      -> decltype(body(index), void()) {
+    body(index);
+  }
+
+  void Run(size_t count, void* context, Task task);
+  void Work(unsigned worker);
+  void Loop(unsigned worker);
+
+  std::vector<std::thread> threads_;
+  std::vector<Share> shares_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  void* context_{nullptr};
+  Task task_{nullptr};
+  unsigned long job_{0};
+  unsigned busy_{0};
+  bool stop_{false};
+};
+
+#endif
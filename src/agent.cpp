@@ -0,0 +1,65 @@
+#include "agent.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "collector.h"
+#include "options.h"
+#include "recorder.h"
+#include "snapshot.h"
+#include "socket_address.h"
+
+using std::chrono::steady_clock;
+
+int Agent::Run(Collector& collector, Options const& options) {
+  SocketAddress address;
+  if (!Socket::ParseAddress(options.agent_address, address)) {
+    std::cerr << options.agent_address
+              << ": not an address, use [HOST]:PORT or unix:PATH\n";
+    return 1;
+  }
+  // A closed connection shows up as a failed write
+  signal(SIGPIPE, SIG_IGN);
+
+  Recorder recorder;
+  bool connected{false};
+  bool reported{false};
+  Snapshot snapshot;
+  steady_clock::time_point next_sample = steady_clock::now();
+  for (unsigned long tick = 0; options.count == 0 || tick < options.count;
+       ++tick) {
+    std::this_thread::sleep_until(next_sample);
+    next_sample = std::max(next_sample + options.interval, steady_clock::now());
+    if (!connected) {
+      int fd = Socket::Connect(address);
+      if (fd >= 0) {
+        // An aggregator that stops reading must not stall the sampling
+        timeval const timeout{5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        recorder.Attach(fd);
+        collector.Record(&recorder);
+        connected = true;
+        reported = false;
+      } else if (!reported) {
+        std::cerr << options.agent_address << ": " << strerror(errno)
+                  << ", retrying every tick\n";
+        reported = true;
+      }
+    }
+    // Sampling goes on while disconnected, so the CPU history is warm
+    collector.Collect(snapshot, options.sort, options.top);
+    if (connected && recorder.Failed()) {
+      std::cerr << options.agent_address << ": connection lost\n";
+      connected = false;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include "aggregator.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "record_format.h"
+#include "record_session.h"
+#include "snapshot.h"
+#include "socket_address.h"
+
+using std::string;
+using std::string_view;
+using namespace RecordFormat;
+
+namespace {
+// An agent with more than this pending is sending no stream
+constexpr size_t kMaxPending{64 << 20};
+constexpr size_t kReadSize{64 << 10};
+// Reads per connection and call, an agent that keeps sending is read
+// again at the next call and holds up neither the others nor the display
+constexpr int kMaxReads{16};
+}  // namespace
+
+Aggregator::~Aggregator() {
+  for (auto const& connection : connections_) close(connection->fd);
+  if (listener_ < 0) return;
+  close(listener_);
+  if (!path_.empty()) unlink(path_.c_str());
+}
+
+bool Aggregator::Listen(SocketAddress const& address) {
+  listener_ = Socket::Listen(address);
+  if (listener_ < 0) return false;
+  if (address.unix_socket) path_ = address.path;
+  return true;
+}
+
+void Aggregator::Request(SortKey key, std::size_t rows, std::size_t first) {
+  if (key == key_ && rows == rows_ && first == first_) return;
+  key_ = key;
+  rows_ = rows;
+  first_ = first;
+  changed_ = true;
+}
+
+// Takes whatever the agents sent since the last call without waiting.
+// The snapshot is only rebuilt if a tick came in, an agent came or went
+// or the request changed.
+Snapshot const& Aggregator::Latest(bool* fresh) {
+  polled_.clear();
+  polled_.push_back({listener_, POLLIN, 0});
+  for (auto const& connection : connections_) {
+    polled_.push_back({connection->fd, POLLIN, 0});
+  }
+  bool updated = changed_;
+  if (poll(polled_.data(), polled_.size(), 0) > 0) {
+    // New connections are polled from the next call on
+    size_t kept{0};
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      bool alive{true};
+      if (polled_[i + 1].revents != 0) {
+        bool ticked{false};
+        alive = Receive(*connections_[i], ticked);
+        updated = updated || ticked || !alive;
+      }
+      if (!alive) {
+        close(connections_[i]->fd);
+        continue;
+      }
+      if (kept != i) connections_[kept] = std::move(connections_[i]);
+      ++kept;
+    }
+    connections_.resize(kept);
+    if (polled_[0].revents & POLLIN) Accept();
+  }
+  if (updated) {
+    sessions_.clear();
+    for (auto const& connection : connections_) {
+      // Agents show up with their first tick
+      if (connection->session.Ticks() > 0) {
+        sessions_.push_back(&connection->session);
+      }
+    }
+    merger_.Fill(sessions_, key_, rows_, first_, true, snapshot_);
+    snapshot_.tick = ++tick_;
+  }
+  changed_ = false;
+  if (fresh != nullptr) *fresh = updated;
+  return snapshot_;
+}
+
+void Aggregator::Accept() {
+  while (true) {
+    int fd =
+        accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    connections_.push_back(std::make_unique<Connection>());
+    connections_.back()->fd = fd;
+  }
+}
+
+// Applies every complete frame that arrived, returns false once the
+// connection has to be dropped
+bool Aggregator::Receive(Connection& connection, bool& ticked) {
+  string& buffer = connection.buffer;
+  for (int reads = 0; reads < kMaxReads; ++reads) {
+    size_t const size = buffer.size();
+    buffer.resize(size + kReadSize);
+    ssize_t received = recv(connection.fd, buffer.data() + size, kReadSize, 0);
+    buffer.resize(size + std::max<ssize_t>(received, 0));
+    if (received == 0) return false;
+    if (received < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      return false;
+    }
+    if (buffer.size() > kMaxPending) return false;
+  }
+  if (!connection.started) {
+    if (buffer.size() < kMagic.size()) return true;
+    if (string_view(buffer.data(), kMagic.size()) != kMagic) return false;
+    connection.offset = kMagic.size();
+    connection.started = true;
+  }
+  uint8_t type;
+  Reader payload(nullptr, nullptr);
+  size_t next;
+  while (FrameAt(buffer.data(), buffer.size(), connection.offset, type,
+                 payload, next)) {
+    if (!connection.session.Apply(type, payload)) return false;
+    if (type == kHost) Name(connection);
+    if (type == kTick) ticked = true;
+    connection.offset = next;
+  }
+  buffer.erase(0, connection.offset);
+  connection.offset = 0;
+  return buffer.size() <= kMaxPending;
+}
+
+// Agents on the same host, e.g. for several proc directories, get a
+// number after the host name to tell them apart
+void Aggregator::Name(Connection& connection) {
+  string const host = connection.session.Host().empty()
+                          ? "unknown"
+                          : connection.session.Host();
+  string name = host;
+  for (int number = 2;; ++number) {
+    bool taken{false};
+    for (auto const& other : connections_) {
+      if (other.get() != &connection && other->session.Host() == name) {
+        taken = true;
+      }
+    }
+    if (!taken) break;
+    name = host + "#" + std::to_string(number);
+  }
+  connection.session.Rename(name);
+}
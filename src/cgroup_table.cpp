@@ -0,0 +1,87 @@
+#include "cgroup_table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu_history.h"
+#include "linux_parser.h"
+#include "process.h"
+
+using std::string;
+using std::vector;
+
+// A dropped cgroup that comes back starts over in any free slot, with a
+// history of its own
+uint32_t CgroupTable::Intern(string const& path) {
+  if (path.empty()) return kNone;
+  uint32_t const slot = free_.empty() ? cgroups_.size() : free_.back();
+  auto [entry, added] = ids_.try_emplace(path, slot);
+  if (added) {
+    if (free_.empty()) {
+      cgroups_.emplace_back();
+    } else {
+      free_.pop_back();
+    }
+    cgroups_[slot].path = path;
+  }
+  return entry->second;
+}
+
+void CgroupTable::Count(vector<Process*> const& processes) {
+  for (ControlGroup& cgroup : cgroups_) cgroup.processes = 0;
+  for (Process* process : processes) {
+    uint32_t const id = process->CgroupId();
+    if (id != kNone) ++cgroups_[id].processes;
+  }
+  populated_.clear();
+  for (uint32_t id = 0; id < cgroups_.size(); ++id) {
+    ControlGroup& cgroup = cgroups_[id];
+    if (cgroup.processes > 0) {
+      populated_.push_back(id);
+    } else if (!cgroup.path.empty()) {
+      ids_.erase(cgroup.path);
+      cgroup = ControlGroup();
+      free_.push_back(id);
+    }
+  }
+}
+
+size_t CgroupTable::Size() const { return populated_.size(); }
+
+// The CPU time of a cgroup is counted in microseconds, the uptime is
+// converted to match so that the history gives the share of one CPU
+void CgroupTable::Sample(size_t i, double uptime,
+                         CpuHistoryConfig const& config) {
+  ControlGroup& cgroup = cgroups_[populated_[i]];
+  LinuxParser::CgroupSample sample;
+  cgroup.readable = LinuxParser::ReadCgroupSample(cgroup.path, sample);
+  if (!cgroup.readable) return;
+  CpuTicks ticks;
+  ticks.busy = sample.usage_usec;
+  ticks.total = uint64_t(uptime * 1e6);
+  cgroup.history.Update(ticks, config);
+  cgroup.memory_kb = sample.memory_kb;
+}
+
+vector<ControlGroup const*> const& CgroupTable::Order(SortKey key, size_t n) {
+  order_.clear();
+  for (uint32_t id : populated_) {
+    if (cgroups_[id].readable) order_.push_back(&cgroups_[id]);
+  }
+  auto before = [key](ControlGroup const* a, ControlGroup const* b) {
+    if (key == SortKey::kCpu &&
+        a->history.Utilization() != b->history.Utilization())
+      return a->history.Utilization() > b->history.Utilization();
+    if (key == SortKey::kMemory && a->memory_kb != b->memory_kb)
+      return a->memory_kb > b->memory_kb;
+    return a->path < b->path;
+  };
+  size_t const shown = std::min(n, order_.size());
+  std::partial_sort(order_.begin(), order_.begin() + shown, order_.end(),
+                    before);
+  order_.resize(shown);
+  return order_;
+}
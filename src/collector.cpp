@@ -0,0 +1,222 @@
+#include "collector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cgroup_table.h"
+#include "filter_index.h"
+#include "overhead.h"
+#include "process.h"
+#include "recorder.h"
+#include "snapshot.h"
+#include "system.h"
+#include "thread_table.h"
+
+using std::vector;
+
+Collector::Collector(System& system, std::chrono::milliseconds period)
+    : system_(system), period_(period) {}
+
+Collector::~Collector() { Stop(); }
+
+void Collector::Start() {
+  if (thread_.joinable()) return;
+  stop_ = false;
+  thread_ = std::thread(&Collector::Run, this);
+}
+
+void Collector::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) thread_.join();
+}
+
+void Collector::Request(SortKey key, std::size_t rows, std::size_t first) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (key == key_ && rows == rows_ && first == first_) return;
+    key_ = key;
+    rows_ = rows;
+    first_ = first;
+    changed_ = true;
+  }
+  wake_.notify_one();
+}
+
+void Collector::Expand(int pid, bool expanded) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto position = std::find(expanded_.begin(), expanded_.end(), pid);
+    if (expanded == (position != expanded_.end())) return;
+    if (expanded) {
+      expanded_.push_back(pid);
+    } else {
+      expanded_.erase(position);
+    }
+    expansion_changed_ = true;
+    changed_ = true;
+  }
+  wake_.notify_one();
+}
+
+Snapshot const& Collector::Latest(bool* fresh) {
+  return exchange_.Latest(fresh);
+}
+
+// The query is parsed on the calling thread, the collector only picks up
+// filters that parsed
+bool Collector::Filter(std::string const& query) {
+  ProcessFilter filter;
+  if (!ProcessFilter::Parse(query, filter)) return true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    filter_ = filter;
+    filter_changed_ = true;
+    changed_ = true;
+  }
+  wake_.notify_one();
+  return true;
+}
+
+void Collector::Record(Recorder* recorder) { recorder_ = recorder; }
+
+void Collector::Collect(Snapshot& snapshot, SortKey key, std::size_t rows,
+                        std::size_t first) {
+  system_.Refresh();
+  vector<Process*>& processes = system_.Processes(key, rows, first);
+  // A recording that cannot be written any more stops, sampling goes on.
+  // It keeps every process, whatever the filter, with users and commands
+  // read on all workers.
+  if (recorder_ != nullptr) {
+    system_.Resolve(system_.AllProcesses());
+    if (!recorder_->Write(system_, system_.AllProcesses())) {
+      recorder_ = nullptr;
+    }
+  }
+  self_.Update();
+  Fill(snapshot, processes, key, rows, first);
+}
+
+// Samples at the start of every period, requests in between re-order the
+// last sample. The mutex only guards the requests and is never held while
+// procfs is read. Until the first tick is sampled in full, every batch is
+// published right away and the next one follows without a wait; that tick
+// is not recorded.
+void Collector::Run() {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point next_sample = Clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  vector<int> expanded;
+  ProcessFilter filter;
+  bool refreshed{false};
+  bool warm{false};
+  std::size_t batch{kFirstBatch};
+  while (!stop_) {
+    SortKey const key = key_;
+    std::size_t const rows = rows_;
+    std::size_t const first = first_;
+    bool const expansion_changed = expansion_changed_;
+    if (expansion_changed) expanded = expanded_;
+    expansion_changed_ = false;
+    bool const filter_changed = filter_changed_;
+    if (filter_changed) filter = filter_;
+    filter_changed_ = false;
+    changed_ = false;
+    lock.unlock();
+
+    if (expansion_changed) system_.Expand(expanded);
+    if (filter_changed) system_.Filter(filter);
+    Snapshot& snapshot = exchange_.Back();
+    if (!warm) {
+      if (!refreshed) {
+        // The system pane needs no process, it is shown before any is read
+        system_.Refresh();
+        self_.Update();
+        refreshed = true;
+      } else {
+        warm = system_.Warm(batch);
+        batch *= 2;
+        if (warm) next_sample = Clock::now() + period_;
+      }
+      Fill(snapshot, system_.Order(key, rows, first), key, rows, first);
+    } else if (Clock::now() >= next_sample) {
+      // Skip the ticks a slow scan overran instead of catching up on them
+      next_sample = std::max(next_sample + period_, Clock::now());
+      Collect(snapshot, key, rows, first);
+    } else {
+      Fill(snapshot, system_.Order(key, rows, first), key, rows, first);
+    }
+    exchange_.Publish();
+
+    lock.lock();
+    if (!warm) continue;
+    wake_.wait_until(lock, next_sample, [this] { return stop_ || changed_; });
+  }
+}
+
+// Copies the values of the shown rows into the snapshot. The strings are
+// assigned into the rows of a reused buffer, so they keep their capacity.
+void Collector::Fill(Snapshot& snapshot, vector<Process*>& processes,
+                     SortKey key, std::size_t rows, std::size_t first) {
+  snapshot.tick = ++tick_;
+  snapshot.samples = system_.Samples();
+  snapshot.os = system_.OperatingSystem();
+  snapshot.kernel = system_.Kernel();
+  snapshot.cpu = system_.Cpu().Utilization();
+  snapshot.memory = system_.MemoryUtilization();
+  snapshot.total_processes = system_.TotalProcesses();
+  snapshot.running_processes = system_.RunningProcesses();
+  snapshot.short_lived = system_.ShortLivedProcesses();
+  snapshot.uptime = system_.UpTime();
+  snapshot.key = key;
+  snapshot.process_count = processes.size();
+  snapshot.phases = system_.Phases();
+  snapshot.self = self_.Usage();
+  // Only the rows in view are copied, and only their users and commands
+  // are read
+  first = std::min(first, processes.size());
+  snapshot.first = first;
+  snapshot.rows.resize(std::min(rows, processes.size() - first));
+  for (std::size_t i = 0; i < snapshot.rows.size(); ++i) {
+    Process& process = *processes[first + i];
+    ProcessRow& row = snapshot.rows[i];
+    row.pid = process.Pid();
+    row.cpu = process.CpuUtilization();
+    row.warming = process.Warming();
+    row.ram_kb = process.RamKb();
+    row.pss_kb = process.PssKb();
+    row.uss_kb = process.UssKb();
+    row.uptime = process.UpTime();
+    row.user = process.User();
+    row.command = process.Command();
+    // An expanded process brings as many threads as there are rows
+    ThreadTable* threads = process.Threads();
+    row.expanded = threads != nullptr;
+    std::size_t const shown =
+        row.expanded ? std::min(rows, threads->Size()) : 0;
+    row.threads.resize(shown);
+    if (shown == 0) continue;
+    vector<Thread const*> const& hottest = threads->Hottest();
+    for (std::size_t j = 0; j < shown; ++j) {
+      row.threads[j].tid = hottest[j]->tid;
+      row.threads[j].cpu = hottest[j]->history.Utilization();
+      row.threads[j].name = hottest[j]->name;
+    }
+  }
+  vector<ControlGroup const*> const& cgroups = system_.Cgroups(key, rows);
+  snapshot.cgroups.resize(cgroups.size());
+  for (std::size_t i = 0; i < cgroups.size(); ++i) {
+    CgroupRow& row = snapshot.cgroups[i];
+    row.path = cgroups[i]->path;
+    row.processes = cgroups[i]->processes;
+    row.cpu = cgroups[i]->history.Utilization();
+    row.memory_kb = cgroups[i]->memory_kb;
+  }
+}
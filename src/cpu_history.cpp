@@ -0,0 +1,76 @@
+#include "cpu_history.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+float Ratio(CpuTicks const& from, CpuTicks const& to) {
+  if (to.total <= from.total || to.busy < from.busy) return 0.0;
+  return float(to.busy - from.busy) / float(to.total - from.total);
+}
+}  // namespace
+
+long ClockTicks() {
+  static const long hz = sysconf(_SC_CLK_TCK);
+  return hz;
+}
+
+// The total time of a task is its age, both counted in clock ticks
+CpuTicks TaskTicks(uint64_t busy, long starttime, double uptime) {
+  long const uptime_ticks = std::lround(uptime * ClockTicks());
+  CpuTicks ticks;
+  ticks.busy = busy;
+  ticks.total = uptime_ticks > starttime ? uptime_ticks - starttime : 0;
+  return ticks;
+}
+
+unsigned Horizon(CpuHistoryConfig const& config) {
+  if (config.mode == UtilizationMode::kSlidingWindow) {
+    return std::clamp<size_t>(config.window, 1, CpuHistory::kMaxWindow);
+  }
+  return std::clamp<long>(std::lround(std::ceil(1 / config.alpha)), 1,
+                          CpuHistory::kMaxWindow);
+}
+
+// A window of n ticks needs n + 1 samples. The moving average only looks
+// at the last two, but keeps as many as the window so carried samples
+// still have the last real one before them.
+float CpuHistory::Update(CpuTicks const& ticks, CpuHistoryConfig const& config,
+                         size_t carried) {
+  bool const ewma = config.mode == UtilizationMode::kEwma;
+  carried = std::min(carried, samples_.Size() > 0 ? samples_.Size() - 1 : 0);
+  if (carried > 0) Spread(ticks, carried);
+  samples_.Push(ticks, Horizon(config) + 1);
+  if (samples_.Size() == 1) {
+    utilization_ = Ratio(CpuTicks(), ticks);
+  } else if (ewma) {
+    // The carried ticks were averaged in as idle, they are made up for at
+    // the rate of the whole gap, like every tick had been sampled
+    float const latest = Ratio(samples_.Previous(), ticks);
+    float const kept = std::pow(1 - config.alpha, float(carried + 1));
+    utilization_ = (1 - config.alpha) * utilization_ + (1 - kept) * latest;
+  } else {
+    utilization_ = Ratio(samples_.Oldest(), ticks);
+  }
+  return utilization_;
+}
+
+// The busy time is spread in proportion to the time each carried sample
+// is after the last real one
+void CpuHistory::Spread(CpuTicks const& ticks, size_t carried) {
+  size_t const newest = samples_.Size() - 1;
+  CpuTicks const base = samples_[newest - carried];
+  if (ticks.total <= base.total || ticks.busy < base.busy) return;
+  double const rate =
+      double(ticks.busy - base.busy) / double(ticks.total - base.total);
+  for (size_t i = newest - carried + 1; i <= newest; ++i) {
+    CpuTicks& sample = samples_[i];
+    if (sample.total < base.total) continue;
+    sample.busy = base.busy + std::llround(rate * (sample.total - base.total));
+    sample.busy = std::min(sample.busy, ticks.busy);
+  }
+}
@@ -0,0 +1,407 @@
+#include "exporter.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "collector.h"
+#include "options.h"
+#include "output_buffer.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+#include "socket_address.h"
+
+using std::string;
+using std::string_view;
+using std::chrono::steady_clock;
+
+namespace {
+// Commands are cut off in labels, a scrape should not carry whole scripts
+constexpr std::size_t kMaxCommand{256};
+// Clients that do not send their request in time are dropped
+constexpr std::chrono::seconds kRequestTimeout{5};
+constexpr std::size_t kMaxClients{64};
+constexpr std::size_t kMaxRequest{8192};
+
+std::atomic<bool> stopped{false};
+
+void Stop(int) { stopped = true; }
+
+void Append(string& out, long number) {
+  char buffer[32];
+  out.append(buffer,
+             std::to_chars(buffer, buffer + sizeof(buffer), number).ptr);
+}
+
+void Append(string& out, double number, int decimals) {
+  char buffer[64];
+  std::to_chars_result result =
+      std::to_chars(buffer, buffer + sizeof(buffer), number,
+                    std::chars_format::fixed, decimals);
+  if (result.ec == std::errc()) out.append(buffer, result.ptr);
+}
+
+// Label values escape backslashes, double quotes and newlines. The text
+// format is UTF-8, bytes of invalid sequences in commands and paths are
+// replaced with U+FFFD so that one process cannot break a whole scrape.
+void AppendLabel(string& out, string_view name, string_view value) {
+  out.append(name);
+  out.append("=\"");
+  auto plain = [](char c) {
+    return static_cast<unsigned char>(c) < 0x80 && c != '\\' && c != '"' &&
+           c != '\n';
+  };
+  if (std::all_of(value.begin(), value.end(), plain)) {
+    out.append(value).push_back('"');
+    return;
+  }
+  for (std::size_t i = 0; i < value.size();) {
+    std::size_t const length = Utf8Length(value.substr(i));
+    if (length == 0) {
+      out.append("\xef\xbf\xbd");
+      ++i;
+      continue;
+    }
+    char const c = value[i];
+    if (c == '\\') {
+      out.append("\\\\");
+    } else if (c == '"') {
+      out.append("\\\"");
+    } else if (c == '\n') {
+      out.append("\\n");
+    } else {
+      out.append(value.substr(i, length));
+    }
+    i += length;
+  }
+  out.push_back('"');
+}
+
+void Family(string& out, string_view name, string_view type,
+            string_view help) {
+  out.append("# HELP ").append(name).push_back(' ');
+  out.append(help).append("\n# TYPE ").append(name).push_back(' ');
+  out.append(type).push_back('\n');
+}
+
+// Starts a metric without labels, the caller appends its value. The line
+// before it is ended here.
+void Scalar(string& out, string_view name, string_view type,
+            string_view help) {
+  if (!out.empty() && out.back() != '\n') out.push_back('\n');
+  Family(out, name, type, help);
+  out.append(name).push_back(' ');
+}
+
+void ProcessLabels(string& out, ProcessRow const& row) {
+  out.append("{pid=\"");
+  Append(out, long(row.pid));
+  out.append("\",");
+  AppendLabel(out, "user", row.user);
+  out.push_back(',');
+  AppendLabel(out, "command",
+              string_view(row.command).substr(0, kMaxCommand));
+  out.append("} ");
+}
+
+void CgroupLabels(string& out, CgroupRow const& row) {
+  out.push_back('{');
+  AppendLabel(out, "cgroup", row.path);
+  out.append("} ");
+}
+
+// The process gauges in kB are exposed in bytes, unknown ones are left out
+void ProcessBytes(string& out, Snapshot const& snapshot, string_view name,
+                  string_view help, long ProcessRow::*kb) {
+  Family(out, name, "gauge", help);
+  for (ProcessRow const& row : snapshot.rows) {
+    if (row.*kb < 0) continue;
+    out.append(name);
+    ProcessLabels(out, row);
+    Append(out, row.*kb * 1024);
+    out.push_back('\n');
+  }
+}
+
+using Response = std::shared_ptr<string const>;
+
+Response MakeResponse(string_view status, string_view body) {
+  auto response = std::make_shared<string>();
+  response->append("HTTP/1.1 ").append(status);
+  response->append(
+      "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+      "Content-Length: ");
+  Append(*response, long(body.size()));
+  response->append("\r\nConnection: close\r\n\r\n").append(body);
+  return response;
+}
+
+// A scrape in flight. Its response stays alive while it is sent, even if
+// a newer snapshot replaced it meanwhile.
+struct Client {
+  int fd;
+  steady_clock::time_point accepted;
+  string request;
+  Response response;
+  std::size_t sent{0};
+};
+
+// Only GET / and GET /metrics are served, the request line decides
+Response Answer(string_view request, Response const& metrics) {
+  static Response const not_found = MakeResponse("404 Not Found", "");
+  static Response const bad_request = MakeResponse("400 Bad Request", "");
+  size_t const end = request.find("\r\n");
+  string_view line = request.substr(0, end);
+  if (line.rfind("GET ", 0) != 0) return bad_request;
+  line.remove_prefix(4);
+  string_view const target = line.substr(0, line.find(' '));
+  return target == "/" || target == "/metrics" ? metrics : not_found;
+}
+
+// Sends what is left of the response, false once the client is done
+bool Send(Client& client) {
+  string const& response = *client.response;
+  while (client.sent < response.size()) {
+    ssize_t count = send(client.fd, response.data() + client.sent,
+                         response.size() - client.sent, MSG_NOSIGNAL);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    client.sent += count;
+  }
+  return false;
+}
+
+// Reads the request, false if the client is gone or sent too much
+bool Receive(Client& client) {
+  char buffer[2048];
+  while (true) {
+    ssize_t count = read(client.fd, buffer, sizeof(buffer));
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (count == 0) return false;
+    client.request.append(buffer, count);
+    if (client.request.size() > kMaxRequest) return false;
+  }
+}
+}  // namespace
+
+void Exporter::Serialize(Snapshot const& snapshot, string& out) {
+  Scalar(out, "monitor_samples_total", "counter",
+         "Ticks the processes were sampled in full.");
+  Append(out, long(snapshot.samples));
+  Scalar(out, "monitor_cpu_utilization", "gauge", "Share of all CPUs in use.");
+  Append(out, double(snapshot.cpu), 4);
+  Scalar(out, "monitor_memory_utilization", "gauge",
+         "Share of memory in use.");
+  Append(out, double(snapshot.memory), 4);
+  Scalar(out, "monitor_processes", "gauge", "Processes on the system.");
+  Append(out, long(snapshot.total_processes));
+  Scalar(out, "monitor_processes_running", "gauge",
+         "Processes running on a CPU.");
+  Append(out, long(snapshot.running_processes));
+  if (snapshot.short_lived >= 0) {
+    Scalar(out, "monitor_processes_short_lived", "gauge",
+           "Processes that started and exited within the last tick.");
+    Append(out, long(snapshot.short_lived));
+  }
+  Scalar(out, "monitor_uptime_seconds", "gauge", "Time since boot.");
+  Append(out, snapshot.uptime);
+  out.push_back('\n');
+
+  Family(out, "monitor_process_cpu_utilization", "gauge",
+         "Share of one CPU a shown process used.");
+  for (ProcessRow const& row : snapshot.rows) {
+    out.append("monitor_process_cpu_utilization");
+    ProcessLabels(out, row);
+    Append(out, double(row.cpu), 4);
+    out.push_back('\n');
+  }
+  ProcessBytes(out, snapshot, "monitor_process_resident_memory_bytes",
+               "Resident set of a shown process.", &ProcessRow::ram_kb);
+  ProcessBytes(out, snapshot, "monitor_process_pss_bytes",
+               "Proportional set of a shown process.", &ProcessRow::pss_kb);
+  ProcessBytes(out, snapshot, "monitor_process_uss_bytes",
+               "Unique set of a shown process.", &ProcessRow::uss_kb);
+  Family(out, "monitor_process_uptime_seconds", "gauge",
+         "Time since a shown process started.");
+  for (ProcessRow const& row : snapshot.rows) {
+    out.append("monitor_process_uptime_seconds");
+    ProcessLabels(out, row);
+    Append(out, row.uptime);
+    out.push_back('\n');
+  }
+
+  Family(out, "monitor_cgroup_cpu_utilization", "gauge",
+         "Share of one CPU a cgroup used.");
+  for (CgroupRow const& row : snapshot.cgroups) {
+    out.append("monitor_cgroup_cpu_utilization");
+    CgroupLabels(out, row);
+    Append(out, double(row.cpu), 4);
+    out.push_back('\n');
+  }
+  Family(out, "monitor_cgroup_memory_bytes", "gauge",
+         "Memory charged to a cgroup.");
+  for (CgroupRow const& row : snapshot.cgroups) {
+    if (row.memory_kb < 0) continue;
+    out.append("monitor_cgroup_memory_bytes");
+    CgroupLabels(out, row);
+    Append(out, row.memory_kb * 1024);
+    out.push_back('\n');
+  }
+  Family(out, "monitor_cgroup_processes", "gauge", "Processes in a cgroup.");
+  for (CgroupRow const& row : snapshot.cgroups) {
+    out.append("monitor_cgroup_processes");
+    CgroupLabels(out, row);
+    Append(out, long(row.processes));
+    out.push_back('\n');
+  }
+
+  // The cost of the monitor itself
+  Family(out, "monitor_tick_phase_seconds", "gauge",
+         "Time the last tick spent in each phase.");
+  PhaseTimes const& phases = snapshot.phases;
+  std::pair<char const*, long> const times[] = {
+      {"scan", phases.scan_us},
+      {"sample", phases.sample_us},
+      {"sort", phases.sort_us}};
+  for (auto [phase, us] : times) {
+    out.append("monitor_tick_phase_seconds{phase=\"").append(phase);
+    out.append("\"} ");
+    Append(out, us / 1e6, 6);
+    out.push_back('\n');
+  }
+  SelfUsage const& self = snapshot.self;
+  if (self.cpu >= 0) {
+    Scalar(out, "monitor_self_cpu_utilization", "gauge",
+           "Share of one CPU the monitor used in the last tick.");
+    Append(out, double(self.cpu), 4);
+  }
+  if (self.rss_kb >= 0) {
+    Scalar(out, "monitor_self_resident_memory_bytes", "gauge",
+           "Resident set of the monitor.");
+    Append(out, self.rss_kb * 1024);
+  }
+  if (self.syscalls >= 0) {
+    Scalar(out, "monitor_self_syscalls", "gauge",
+           "Read and write system calls of the monitor in the last tick.");
+    Append(out, self.syscalls);
+  }
+  if (out.back() != '\n') out.push_back('\n');
+}
+
+// One thread serves all scrapes with poll. It wakes up at least every
+// 50 ms to pick up a fresh snapshot, which is serialized right away, so
+// the cost of a scrape does not depend on the number of processes.
+int Exporter::Serve(int listener, SnapshotSource& source,
+                    std::atomic<bool> const& stop) {
+  // Until the first sample, scrapes are told to come back later
+  Response metrics = MakeResponse("503 Service Unavailable", "");
+  bool ready{false};
+  string body;
+  std::vector<Client> clients;
+  std::vector<pollfd> polled;
+  int status = 0;
+  while (!stop) {
+    bool fresh;
+    Snapshot const& snapshot = source.Latest(&fresh);
+    // A snapshot the source published before it was handed over counts
+    if (fresh || (!ready && snapshot.tick > 0)) {
+      body.clear();
+      Serialize(snapshot, body);
+      metrics = MakeResponse("200 OK", body);
+      ready = true;
+    }
+
+    // With the table full the listener is not polled, a connection
+    // waiting in its backlog would wake the loop right away forever
+    polled.clear();
+    short const accepting = clients.size() < kMaxClients ? POLLIN : 0;
+    polled.push_back({listener, accepting, 0});
+    for (Client const& client : clients) {
+      short const events = client.response ? POLLOUT : POLLIN;
+      polled.push_back({client.fd, events, 0});
+    }
+    if (poll(polled.data(), polled.size(), 50) < 0 && errno != EINTR) {
+      status = 1;
+      break;
+    }
+
+    steady_clock::time_point const now = steady_clock::now();
+    std::size_t kept{0};
+    for (std::size_t i = 0; i < clients.size(); ++i) {
+      Client& client = clients[i];
+      short const events = polled[i + 1].revents;
+      bool open = now - client.accepted < kRequestTimeout;
+      if (open && events != 0) {
+        if (!client.response) {
+          open = Receive(client);
+          if (client.request.find("\r\n\r\n") != string::npos) {
+            client.response = Answer(client.request, metrics);
+          }
+        }
+        // Responses fit the socket buffer, so this is a single send
+        if (client.response) open = Send(client);
+      }
+      if (open) {
+        if (kept != i) clients[kept] = std::move(client);
+        ++kept;
+      } else {
+        close(client.fd);
+      }
+    }
+    clients.resize(kept);
+
+    if (polled[0].revents & POLLIN) {
+      while (clients.size() < kMaxClients) {
+        int fd = accept4(listener, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) break;
+        clients.push_back({fd, now, string(), nullptr, 0});
+      }
+    }
+  }
+  for (Client const& client : clients) close(client.fd);
+  return status;
+}
+
+int Exporter::Run(Collector& collector, Options const& options) {
+  SocketAddress address;
+  if (!Socket::ParseAddress(options.export_address, address)) {
+    std::cerr << options.export_address
+              << ": not an address, use [HOST]:PORT or unix:PATH\n";
+    return 1;
+  }
+  int const listener = Socket::Listen(address);
+  if (listener < 0) {
+    std::cerr << options.export_address << ": " << strerror(errno) << "\n";
+    return 1;
+  }
+  // SIGINT and SIGTERM end the loop, so a unix socket is removed again
+  signal(SIGINT, Stop);
+  signal(SIGTERM, Stop);
+  collector.Request(options.sort, options.top);
+  collector.Start();
+  int const status = Serve(listener, collector, stopped);
+  collector.Stop();
+  close(listener);
+  if (address.unix_socket) unlink(address.path.c_str());
+  return status;
+}
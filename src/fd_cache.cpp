@@ -0,0 +1,64 @@
+#include "fd_cache.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstddef>
+
+namespace {
+// An unlimited soft limit still gets a bound, the kernel has one anyway
+constexpr std::size_t kMaxBudget{1 << 20};
+
+std::size_t BudgetFromLimit() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return 0;
+  if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > kMaxBudget * 2)
+    return kMaxBudget;
+  return limit.rlim_cur / 4 * 3;
+}
+}  // namespace
+
+FdCache::FdCache(std::size_t limit)
+    : limit_(limit > 0 ? limit : BudgetFromLimit()) {}
+
+bool FdCache::Acquire() {
+  std::size_t open = open_.load(std::memory_order_relaxed);
+  do {
+    if (open >= limit_) return false;
+  } while (!open_.compare_exchange_weak(open, open + 1,
+                                        std::memory_order_relaxed));
+  return true;
+}
+
+void FdCache::Release() { open_.fetch_sub(1, std::memory_order_relaxed); }
+
+std::size_t FdCache::Open() const {
+  return open_.load(std::memory_order_relaxed);
+}
+
+std::size_t FdCache::Limit() const { return limit_; }
+
+bool FdCache::Full() const { return Open() >= limit_; }
+
+CachedFile::~CachedFile() { Close(); }
+
+bool CachedFile::Open(char const* path, FdCache* cache) {
+  Close();
+  if (cache != nullptr && !cache->Acquire()) return false;
+  fd_ = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    if (cache != nullptr) cache->Release();
+    return false;
+  }
+  cache_ = cache;
+  return true;
+}
+
+void CachedFile::Close() {
+  if (fd_ < 0) return;
+  close(fd_);
+  fd_ = -1;
+  if (cache_ != nullptr) cache_->Release();
+  cache_ = nullptr;
+}
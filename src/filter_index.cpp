@@ -0,0 +1,203 @@
+#include "filter_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "process.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+// Only ASCII letters are folded, the rest is compared byte for byte
+void AppendLower(string& out, string_view text) {
+  for (char c : text) {
+    out += char(std::tolower(static_cast<unsigned char>(c)));
+  }
+}
+
+uint32_t Trigram(char const* text) {
+  return uint32_t(uint8_t(text[0])) << 16 | uint32_t(uint8_t(text[1])) << 8 |
+         uint8_t(text[2]);
+}
+
+bool Number(string_view text, int& value) {
+  char const* end = text.data() + text.size();
+  auto [position, error] = std::from_chars(text.data(), end, value);
+  return error == std::errc() && position == end && value >= 0;
+}
+}  // namespace
+
+bool ProcessFilter::Parse(string_view query, ProcessFilter& filter) {
+  ProcessFilter parsed;
+  while (!query.empty()) {
+    size_t const begin = query.find_first_not_of(' ');
+    if (begin == string_view::npos) break;
+    query.remove_prefix(begin);
+    size_t const end = std::min(query.find(' '), query.size());
+    string_view word = query.substr(0, end);
+    query.remove_prefix(end);
+    if (word.rfind("user=", 0) == 0) {
+      parsed.user = string(word.substr(5));
+    } else if (word.rfind("pid=", 0) == 0) {
+      string_view range = word.substr(4);
+      size_t const dash = range.find('-');
+      if (!Number(range.substr(0, dash), parsed.pid_from)) return false;
+      parsed.pid_to = parsed.pid_from;
+      if (dash != string_view::npos &&
+          !Number(range.substr(dash + 1), parsed.pid_to)) {
+        return false;
+      }
+    } else {
+      if (!parsed.command.empty()) parsed.command += ' ';
+      AppendLower(parsed.command, word);
+    }
+  }
+  filter = parsed;
+  return true;
+}
+
+bool ProcessFilter::Empty() const {
+  return user.empty() && command.empty() && pid_from == 0 &&
+         pid_to == INT_MAX;
+}
+
+bool ProcessFilter::NeedsText() const {
+  return !user.empty() || !command.empty();
+}
+
+void FilterIndex::Add(Process& process) {
+  Remove(process.Pid());
+  uint32_t id;
+  if (free_.empty()) {
+    id = entries_.size();
+    entries_.emplace_back();
+  } else {
+    id = free_.back();
+    free_.pop_back();
+  }
+  Entry& entry = entries_[id];
+  entry.process = &process;
+  entry.postings = 0;
+  ids_[process.Pid()] = id;
+  pids_[process.Pid()] = id;
+  if (text_) Post(id);
+}
+
+// A trigram that occurs several times in a command is posted once
+void FilterIndex::Post(uint32_t id) {
+  Entry& entry = entries_[id];
+  Process& process = *entry.process;
+  entry.command.clear();
+  AppendLower(entry.command, process.Command());
+  Posting const posting{id, entry.generation};
+  thread_local vector<uint32_t> trigrams;
+  trigrams.clear();
+  for (size_t i = 0; i + 3 <= entry.command.size(); ++i) {
+    trigrams.push_back(Trigram(entry.command.data() + i));
+  }
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                 trigrams.end());
+  for (uint32_t trigram : trigrams) trigrams_[trigram].push_back(posting);
+  users_[process.User()].push_back(posting);
+  entry.postings = trigrams.size() + 1;
+  postings_ += entry.postings;
+}
+
+void FilterIndex::Remove(int pid) {
+  auto position = ids_.find(pid);
+  if (position == ids_.end()) return;
+  uint32_t const id = position->second;
+  Entry& entry = entries_[id];
+  retired_ += entry.postings;
+  entry.process = nullptr;
+  ++entry.generation;
+  free_.push_back(id);
+  ids_.erase(position);
+  pids_.erase(pid);
+  if (retired_ > postings_ - retired_) Compact();
+}
+
+bool FilterIndex::Live(Posting posting) const {
+  Entry const& entry = entries_[posting.id];
+  return entry.process != nullptr && entry.generation == posting.generation;
+}
+
+// Drops the postings of removed processes and the lists left empty
+void FilterIndex::Compact() {
+  auto dead = [this](Posting posting) { return !Live(posting); };
+  postings_ = 0;
+  auto sweep = [&](auto& lists) {
+    for (auto list = lists.begin(); list != lists.end();) {
+      vector<Posting>& postings = list->second;
+      postings.erase(std::remove_if(postings.begin(), postings.end(), dead),
+                     postings.end());
+      postings_ += postings.size();
+      if (postings.empty()) {
+        list = lists.erase(list);
+      } else {
+        ++list;
+      }
+    }
+  };
+  sweep(trigrams_);
+  sweep(users_);
+  retired_ = 0;
+}
+
+// DONE: Start from the smallest set of candidates the filter allows, the
+// rarest trigram of the command, the processes of the user or the PID
+// range, and check the whole filter on each of them
+void FilterIndex::Match(ProcessFilter const& filter, vector<Process*>& out) {
+  if (filter.NeedsText() && !text_) {
+    text_ = true;
+    for (auto const& pid : pids_) Post(pid.second);
+  }
+  auto matches = [&filter](Entry const& entry) {
+    int const pid = entry.process->Pid();
+    return pid >= filter.pid_from && pid <= filter.pid_to &&
+           (filter.user.empty() || entry.process->User() == filter.user) &&
+           entry.command.find(filter.command) != string::npos;
+  };
+  vector<Posting> const* candidates{nullptr};
+  static vector<Posting> const kNone;
+  if (!filter.user.empty()) {
+    auto users = users_.find(filter.user);
+    candidates = users == users_.end() ? &kNone : &users->second;
+  }
+  for (size_t i = 0; i + 3 <= filter.command.size(); ++i) {
+    auto list = trigrams_.find(Trigram(filter.command.data() + i));
+    if (list == trigrams_.end()) {
+      candidates = &kNone;
+      break;
+    }
+    if (candidates == nullptr || list->second.size() < candidates->size()) {
+      candidates = &list->second;
+    }
+  }
+  if (candidates != nullptr) {
+    for (Posting posting : *candidates) {
+      if (!Live(posting)) continue;
+      Entry const& entry = entries_[posting.id];
+      if (matches(entry)) out.push_back(entry.process);
+    }
+    return;
+  }
+  // Neither a user nor three characters of the command, the PID range
+  // is all there is to narrow the processes down
+  auto const end = pids_.upper_bound(filter.pid_to);
+  for (auto pid = pids_.lower_bound(filter.pid_from); pid != end; ++pid) {
+    Entry const& entry = entries_[pid->second];
+    if (matches(entry)) out.push_back(entry.process);
+  }
+}
+
+bool FilterIndex::IndexesText() const { return text_; }
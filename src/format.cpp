@@ -1,6 +1,7 @@
 #include "format.h"
 
 #include <chrono>
+#include <cstdio>
 #include <sstream>
 #include <string>
 
@@ -18,6 +19,13 @@ string Format::TwoDigits(string const &timestr) {
     return timestr;
 }
 
+// Function to format a memory size given in kB as MB with one decimal
+string Format::Megabytes(long kilobytes) {
+  char megabytes[32];
+  snprintf(megabytes, sizeof(megabytes), "%.1f", float(kilobytes) / 1000);
+  return megabytes;
+}
+
 // DONE: Complete this helper function
 // INPUT: Long int measuring seconds
 // OUTPUT: HH:MM:SS
@@ -0,0 +1,222 @@
+#include "headless.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "collector.h"
+#include "options.h"
+#include "output_buffer.h"
+#include "snapshot.h"
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
+namespace {
+long EpochMilliseconds() {
+  return std::chrono::duration_cast<milliseconds>(
+             system_clock::now().time_since_epoch())
+      .count();
+}
+
+// {"tick":1,"time_ms":...,"cpu":...,...,"processes":[{"pid":1,...},...],
+//  "cgroups":[{"path":"/",...},...]}
+void WriteNdjson(OutputBuffer& out, Snapshot const& snapshot, long time_ms) {
+  out.Append("{\"tick\":");
+  out.Append(long(snapshot.tick));
+  out.Append(",\"time_ms\":");
+  out.Append(time_ms);
+  out.Append(",\"cpu\":");
+  out.Append(double(snapshot.cpu), 4);
+  out.Append(",\"memory\":");
+  out.Append(double(snapshot.memory), 4);
+  out.Append(",\"total_processes\":");
+  out.Append(long(snapshot.total_processes));
+  out.Append(",\"running_processes\":");
+  out.Append(long(snapshot.running_processes));
+  // Only known while following process events
+  if (snapshot.short_lived >= 0) {
+    out.Append(",\"short_lived\":");
+    out.Append(long(snapshot.short_lived));
+  }
+  out.Append(",\"uptime\":");
+  out.Append(snapshot.uptime);
+  // What the tick cost the monitor, its usage is unknown on the first one
+  out.Append(",\"overhead\":{\"scan_us\":");
+  out.Append(snapshot.phases.scan_us);
+  out.Append(",\"sample_us\":");
+  out.Append(snapshot.phases.sample_us);
+  out.Append(",\"sort_us\":");
+  out.Append(snapshot.phases.sort_us);
+  if (snapshot.self.cpu >= 0) {
+    out.Append(",\"cpu\":");
+    out.Append(double(snapshot.self.cpu), 4);
+  }
+  if (snapshot.self.rss_kb >= 0) {
+    out.Append(",\"rss_kb\":");
+    out.Append(snapshot.self.rss_kb);
+  }
+  if (snapshot.self.syscalls >= 0) {
+    out.Append(",\"syscalls\":");
+    out.Append(snapshot.self.syscalls);
+  }
+  out.Append("},\"processes\":[");
+  for (std::size_t i = 0; i < snapshot.rows.size(); ++i) {
+    ProcessRow const& row = snapshot.rows[i];
+    if (i > 0) out.Append(',');
+    out.Append("{\"pid\":");
+    out.Append(long(row.pid));
+    out.Append(",\"user\":");
+    out.AppendJson(row.user);
+    out.Append(",\"cpu\":");
+    out.Append(double(row.cpu), 4);
+    out.Append(",\"ram_kb\":");
+    out.Append(row.ram_kb);
+    // smaps_rollup is not readable for every process
+    if (row.pss_kb >= 0) {
+      out.Append(",\"pss_kb\":");
+      out.Append(row.pss_kb);
+      out.Append(",\"uss_kb\":");
+      out.Append(row.uss_kb);
+    }
+    out.Append(",\"uptime\":");
+    out.Append(row.uptime);
+    out.Append(",\"command\":");
+    out.AppendJson(row.command);
+    out.Append('}');
+  }
+  out.Append("],\"cgroups\":[");
+  for (std::size_t i = 0; i < snapshot.cgroups.size(); ++i) {
+    CgroupRow const& cgroup = snapshot.cgroups[i];
+    if (i > 0) out.Append(',');
+    out.Append("{\"path\":");
+    out.AppendJson(cgroup.path);
+    out.Append(",\"processes\":");
+    out.Append(long(cgroup.processes));
+    out.Append(",\"cpu\":");
+    out.Append(double(cgroup.cpu), 4);
+    if (cgroup.memory_kb >= 0) {
+      out.Append(",\"memory_kb\":");
+      out.Append(cgroup.memory_kb);
+    }
+    out.Append('}');
+  }
+  out.Append("]}\n");
+}
+
+constexpr char kCsvHeader[] =
+    "tick,time_ms,system_cpu,memory,total_processes,running_processes,"
+    "short_lived,system_uptime,scan_us,sample_us,sort_us,monitor_cpu,"
+    "monitor_rss_kb,monitor_syscalls,pid,user,cpu,ram_kb,pss_kb,uss_kb,"
+    "uptime,command\n";
+
+// The system columns are repeated on every process line of a tick, a tick
+// without processes still gets one line with empty process columns
+void WriteCsv(OutputBuffer& out, Snapshot const& snapshot, long time_ms) {
+  std::size_t const lines = snapshot.rows.empty() ? 1 : snapshot.rows.size();
+  for (std::size_t i = 0; i < lines; ++i) {
+    out.Append(long(snapshot.tick));
+    out.Append(',');
+    out.Append(time_ms);
+    out.Append(',');
+    out.Append(double(snapshot.cpu), 4);
+    out.Append(',');
+    out.Append(double(snapshot.memory), 4);
+    out.Append(',');
+    out.Append(long(snapshot.total_processes));
+    out.Append(',');
+    out.Append(long(snapshot.running_processes));
+    out.Append(',');
+    if (snapshot.short_lived >= 0) out.Append(long(snapshot.short_lived));
+    out.Append(',');
+    out.Append(snapshot.uptime);
+    out.Append(',');
+    out.Append(snapshot.phases.scan_us);
+    out.Append(',');
+    out.Append(snapshot.phases.sample_us);
+    out.Append(',');
+    out.Append(snapshot.phases.sort_us);
+    out.Append(',');
+    if (snapshot.self.cpu >= 0) out.Append(double(snapshot.self.cpu), 4);
+    out.Append(',');
+    if (snapshot.self.rss_kb >= 0) out.Append(snapshot.self.rss_kb);
+    out.Append(',');
+    if (snapshot.self.syscalls >= 0) out.Append(snapshot.self.syscalls);
+    if (snapshot.rows.empty()) {
+      out.Append(",,,,,,,,\n");
+      continue;
+    }
+    ProcessRow const& row = snapshot.rows[i];
+    out.Append(',');
+    out.Append(long(row.pid));
+    out.Append(',');
+    out.AppendCsv(row.user);
+    out.Append(',');
+    out.Append(double(row.cpu), 4);
+    out.Append(',');
+    out.Append(row.ram_kb);
+    out.Append(',');
+    if (row.pss_kb >= 0) out.Append(row.pss_kb);
+    out.Append(',');
+    if (row.uss_kb >= 0) out.Append(row.uss_kb);
+    out.Append(',');
+    out.Append(row.uptime);
+    out.Append(',');
+    out.AppendCsv(row.command);
+    out.Append('\n');
+  }
+}
+}  // namespace
+
+int Headless::Run(Collector& collector, Options const& options) {
+  int fd = STDOUT_FILENO;
+  if (!options.output.empty()) {
+    fd = open(options.output.c_str(),
+              O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      std::cerr << options.output << ": " << strerror(errno) << "\n";
+      return 1;
+    }
+  }
+
+  // A reader that went away, like head at the end of a pipe, shows up as
+  // a failed flush and ends the run with an error
+  signal(SIGPIPE, SIG_IGN);
+
+  int status = 0;
+  {
+    OutputBuffer out(fd);
+    if (options.format == OutputFormat::kCsv) out.Append(kCsvHeader);
+    // The snapshot is reused for every tick, so are its rows and strings
+    Snapshot snapshot;
+    steady_clock::time_point next_sample = steady_clock::now();
+    for (unsigned long tick = 0; options.count == 0 || tick < options.count;
+         ++tick) {
+      std::this_thread::sleep_until(next_sample);
+      next_sample =
+          std::max(next_sample + options.interval, steady_clock::now());
+      collector.Collect(snapshot, options.sort, options.top);
+      long const time_ms = EpochMilliseconds();
+      if (options.format == OutputFormat::kCsv) {
+        WriteCsv(out, snapshot, time_ms);
+      } else {
+        WriteNdjson(out, snapshot, time_ms);
+      }
+      // Every tick is flushed so that readers see it right away
+      if (!out.Flush()) {
+        status = 1;
+        break;
+      }
+    }
+  }
+  if (fd != STDOUT_FILENO) close(fd);
+  return status;
+}
@@ -1,277 +1,402 @@
 #include "linux_parser.h"
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstdio>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
-using std::getline;
+#include "fd_cache.h"
+#include "proc_reader.h"
+
 using std::map;
-using std::stof;
-using std::stoi;
-using std::stol;
 using std::string;
-using std::to_string;
+using std::string_view;
 using std::vector;
 
-// Helper function to read lines from files and put them into a vector
-vector<string> LinuxParser::GetLines(string const &filepath) {
-  string line;
-  vector<string> linevec;
-  std::ifstream filestream(filepath);
-  if (filestream.is_open()) {
-    while (getline(filestream, line)) {
-      linevec.push_back(line);
-    }
+namespace {
+string proc_directory{"/proc/"};
+
+// Hosts with only cgroup v1 controllers may still mount the unified
+// hierarchy next to them
+string DefaultCgroupDirectory() {
+  for (char const *directory : {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"}) {
+    string controllers = string(directory) + "/cgroup.controllers";
+    if (access(controllers.c_str(), R_OK) == 0) return directory;
   }
-  return linevec;
+  return string();
+}
+string cgroup_directory{DefaultCgroupDirectory()};
+
+// Every thread parses through its own reader, so the read buffer is
+// allocated once per thread and reused for every procfs file
+thread_local ProcReader reader;
+
+// Builds /proc/<file> and /proc/<pid>/<file> into a caller provided buffer
+const char *ProcPath(char *buffer, size_t size, string const &file) {
+  snprintf(buffer, size, "%s%s", proc_directory.c_str(), file.c_str());
+  return buffer;
 }
 
-// Helper function to split line elements into a vector given a separator
-vector<string> LinuxParser::GetLineElements(string const &line,
-                                            char const &separator) {
-  string item;
-  vector<string> elements;
-  std::stringstream linestream(line);
-  while (getline(linestream, item, separator)) {
-    elements.push_back(item);
+const char *PidPath(char *buffer, size_t size, int pid, string const &file) {
+  snprintf(buffer, size, "%s%d%s", proc_directory.c_str(), pid, file.c_str());
+  return buffer;
+}
+
+// Reads a file through the fd kept open for it, or by path if it has none.
+// A file that is not open yet is opened and kept if the cache has room.
+// One that cannot be read any more is closed and opened again by path:
+// its process is gone and the PID may have been taken by a new one.
+template <typename Path>
+bool ReadFile(CachedFile *file, FdCache *cache, Path path) {
+  char buffer[PATH_MAX];
+  if (file == nullptr) return reader.Read(path(buffer, sizeof(buffer)));
+  if (file->IsOpen()) {
+    if (reader.Read(file->Fd())) return true;
+    file->Close();
   }
-  return elements;
+  char const *opened = path(buffer, sizeof(buffer));
+  if (!file->Open(opened, cache)) return reader.Read(opened);
+  return reader.Read(file->Fd());
 }
 
-// Helper function to read files line by line and to push every item in the line
-// to a vector. This vector is then pushed onto another vector.
-vector<vector<string>> LinuxParser::GetSpacedContent(string const &filepath,
-                                                     char const &separator) {
-  vector<vector<string>> contentvec;
-  vector<string> linevector = GetLines(filepath);
-  for (string &line : linevector) {
-    contentvec.push_back(GetLineElements(line, separator));
+// Positions the tokenizer on the state field of the stat file just read.
+// The command name is skipped up to the last ')' as it may contain spaces.
+bool StatFields(Tokenizer &fields, string_view *name = nullptr) {
+  string_view content = reader.Content();
+  size_t commstart = content.find('(');
+  size_t commend = content.rfind(')');
+  if (commstart == string_view::npos || commend == string_view::npos ||
+      commend < commstart)
+    return false;
+  if (name != nullptr) {
+    *name = content.substr(commstart + 1, commend - commstart - 1);
   }
-  return contentvec;
+  fields = Tokenizer(content.substr(commend + 1));
+  return true;
+}
+
+bool PidStatFields(int pid, Tokenizer &fields, CachedFile *file = nullptr,
+                   FdCache *cache = nullptr) {
+  return ReadFile(file, cache,
+                  [pid](char *buffer, size_t size) {
+                    return PidPath(buffer, size, pid,
+                                   LinuxParser::kStatFilename);
+                  }) &&
+         StatFields(fields);
 }
 
-// This Helper function reads files line by line and extracts Key/Values
-// from the lines it can also remove unwanted characters from the line
-map<string, string> LinuxParser::GetKVContent(string const &filepath,
-                                              char const &separator,
-                                              vector<char> const &removechars) {
-  string key, value;
-  map<string, string> dict;
-  vector<string> linevector = GetLines(filepath);
-  for (string &line : linevector) {
-    std::stringstream linestream(line);
-    getline(linestream, key, separator);
-    getline(linestream, value, separator);
-    for (char toremove : removechars) {
-      key.erase(remove(key.begin(), key.end(), toremove), key.end());
-      value.erase(remove(value.begin(), value.end(), toremove), value.end());
+// Layout of the records getdents64 fills the buffer with
+struct Dirent64 {
+  ino64_t d_ino;
+  off64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+// Names of PID directories consist of digits only
+bool IsPid(const char *name, int &pid) {
+  string_view filename(name);
+  if (filename.empty()) return false;
+  for (char c : filename) {
+    if (c < '0' || c > '9') return false;
+  }
+  return ParseNumber(filename, pid);
+}
+
+// PID and TID directories are listed with getdents64 into a stack buffer,
+// so a scan of a few thousand entries takes a handful of system calls and
+// no allocation besides growing the caller's vector
+void ListIds(const char *directory, vector<int> &ids) {
+  ids.clear();
+  int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return;
+  alignas(Dirent64) char buffer[32768];
+  while (true) {
+    long count = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+    if (count <= 0) break;
+    for (long offset = 0; offset < count;) {
+      Dirent64 const *entry = reinterpret_cast<Dirent64 *>(buffer + offset);
+      offset += entry->d_reclen;
+      // Some file systems leave the type to a stat call, a PID directory
+      // is recognized by its name alone then
+      if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) continue;
+      int id;
+      if (IsPid(entry->d_name, id)) ids.push_back(id);
     }
-    dict.insert({key, value});
   }
-  return dict;
+  close(fd);
+}
+}  // namespace
+
+string const &LinuxParser::ProcDirectory() { return proc_directory; }
+
+// The directory is joined with the file names, so it ends with a '/'
+void LinuxParser::SetProcDirectory(string const &directory) {
+  proc_directory = directory;
+  if (proc_directory.empty() || proc_directory.back() != '/') {
+    proc_directory += '/';
+  }
+}
+
+string const &LinuxParser::CgroupDirectory() { return cgroup_directory; }
+
+// Cgroup paths start with a '/', so the directory does not end with one
+void LinuxParser::SetCgroupDirectory(string const &directory) {
+  cgroup_directory = directory;
+  while (!cgroup_directory.empty() && cgroup_directory.back() == '/') {
+    cgroup_directory.pop_back();
+  }
 }
 
 // DONE: Refactored OperatorSystem function using external function for
 // modularity. Modified from original Udacity example
 string LinuxParser::OperatingSystem() {
-  vector<char> removechars{'"'};
-  map<string, string> osinfo = GetKVContent(kOSPath, '=', removechars);
-  return osinfo["PRETTY_NAME"];
+  if (!reader.Read(kOSPath.c_str())) return string();
+  string_view name = FindLine(reader.Content(), "PRETTY_NAME=");
+  if (name.size() >= 2 && name.front() == '"' && name.back() == '"') {
+    name = name.substr(1, name.size() - 2);
+  }
+  return string(name);
 }
 
 // DONE: Modified from original Udacity example
 string LinuxParser::Kernel() {
-  string filepath = kProcDirectory + kVersionFilename;
-  vector<vector<string>> filecontent = GetSpacedContent(filepath, ' ');
-  // in the kernel version file the kernel name is in the first
-  // line and third position [0][2]
-  return filecontent[0][2];
-}
-
-// BONUS: Update this to use std::filesystem
-vector<int> LinuxParser::Pids() {
-  vector<int> pids;
-  DIR *directory = opendir(kProcDirectory.c_str());
-  struct dirent *file;
-  while ((file = readdir(directory)) != nullptr) {
-    // Is this a directory?
-    if (file->d_type == DT_DIR) {
-      // Is every character of the name a digit?
-      string filename(file->d_name);
-      if (std::all_of(filename.begin(), filename.end(), isdigit)) {
-        int pid = stoi(filename);
-        pids.push_back(pid);
-      }
-    }
-  }
-  closedir(directory);
-  return pids;
+  char path[PATH_MAX];
+  if (!reader.Read(ProcPath(path, sizeof(path), kVersionFilename)))
+    return string();
+  // in the kernel version file the kernel name is the third token
+  Tokenizer tokens(reader.Content());
+  string_view kernel;
+  if (!tokens.Skip(2) || !tokens.NextToken(kernel)) return string();
+  return string(kernel);
 }
 
-// DONE: Read and return the system memory utilization
-float LinuxParser::MemoryUtilization() {
-  vector<char> removechars{' ', 'k', 'B'};
-  string filepath = kProcDirectory + kMeminfoFilename;
-  map<string, string> meminfo = GetKVContent(filepath, ':', removechars);
-  float memuse_kb = stof(meminfo["MemTotal"]) - stof(meminfo["MemAvailable"]);
-  return memuse_kb / stof(meminfo["MemTotal"]);
+// DONE: List the processes, their IDs are directories of /proc
+void LinuxParser::Pids(vector<int> &pids) {
+  ListIds(proc_directory.c_str(), pids);
 }
 
-// DONE: Read and return the system uptime
-long LinuxParser::UpTime() {
-  string filepath = kProcDirectory + kUptimeFilename;
-  vector<vector<string>> filecontent = GetSpacedContent(filepath, ' ');
-  // in the proc/uptime file the uptime in seconds is in the first
-  // line and first position [0][0]
-  return stol(filecontent[0][0]);
+// DONE: List the threads of a process, their IDs are directories of
+// /proc/<pid>/task
+void LinuxParser::Tids(int pid, vector<int> &tids) {
+  char path[PATH_MAX];
+  ListIds(PidPath(path, sizeof(path), pid, kTaskDirectory), tids);
 }
 
-// DONE: Read and return CPU utilization
-map<string, long> LinuxParser::CpuUtilization() {
-  map<string, long> cpustats;
-  string filepath = kProcDirectory + kStatFilename;
-  vector<vector<string>> filecontent = GetSpacedContent(filepath, ' ');
-  try {
-    vector<string> &cpuline = filecontent.at(0);
-    long user = stol(cpuline.at(2));
-    long nice = stol(cpuline.at(3));
-    long system = stol(cpuline.at(4));
-    long idle = stol(cpuline.at(5));
-    long iowait = stol(cpuline.at(6));
-    long irq = stol(cpuline.at(7));
-    long softirq = stol(cpuline.at(8));
-    long steal = stol(cpuline.at(9));
-    cpustats["Idle"] = idle + iowait;
-    cpustats["NonIdle"] = user + nice + system + irq + softirq + steal;
-    cpustats["Total"] = cpustats["Idle"] + cpustats["NonIdle"];
-  } catch (const std::out_of_range &oor) {
-    cpustats["Idle"] = 0;
-    cpustats["NonIdle"] = 0;
-    cpustats["Total"] = 0;
+// DONE: Read the system wide values of this tick. Every file is read once,
+// /proc/stat serves the CPU times as well as both process counts
+void LinuxParser::ReadSystemSnapshot(SystemSnapshot &snapshot,
+                                     SystemFiles *files) {
+  snapshot = SystemSnapshot();
+  auto path = [](string const &file) {
+    return [&file](char *buffer, size_t size) {
+      return ProcPath(buffer, size, file);
+    };
+  };
+  long values[kSteal_ + 1] = {};
+  if (ReadFile(files ? &files->stat : nullptr, nullptr,
+               path(kStatFilename))) {
+    Tokenizer lines(reader.Content());
+    string_view line;
+    while (lines.NextLine(line)) {
+      Tokenizer fields(line);
+      string_view key;
+      if (!fields.NextToken(key)) continue;
+      if (key == "cpu") {
+        for (long &value : values) {
+          if (!fields.NextNumber(value)) break;
+        }
+      } else if (key == "processes") {
+        fields.NextNumber(snapshot.total_processes);
+      } else if (key == "procs_running") {
+        fields.NextNumber(snapshot.running_processes);
+      }
+    }
   }
-  return cpustats;
-}
+  snapshot.cpu.idle = values[kIdle_] + values[kIOwait_];
+  snapshot.cpu.nonidle = values[kUser_] + values[kNice_] + values[kSystem_] +
+                         values[kIRQ_] + values[kSoftIRQ_] + values[kSteal_];
+  snapshot.cpu.total = snapshot.cpu.idle + snapshot.cpu.nonidle;
 
-// DONE: Read and return the total number of processes
-int LinuxParser::TotalProcesses() {
-  string filepath = kProcDirectory + kStatFilename;
-  vector<vector<string>> filecontent = GetSpacedContent(filepath, ' ');
-  // in the proc/stats file the processes count is in the seventh
-  // line and second position [6][1]
-  return stoi(filecontent[6][1]);
-}
+  if (ReadFile(files ? &files->meminfo : nullptr, nullptr,
+               path(kMeminfoFilename))) {
+    string_view content = reader.Content();
+    Tokenizer(FindLine(content, "MemTotal:")).NextNumber(snapshot.mem_total_kb);
+    Tokenizer(FindLine(content, "MemAvailable:"))
+        .NextNumber(snapshot.mem_available_kb);
+  }
 
-// DONE: Read and return the number of running processes
-int LinuxParser::RunningProcesses() {
-  string filepath = kProcDirectory + kStatFilename;
-  vector<vector<string>> filecontent = GetSpacedContent(filepath, ' ');
-  // in the proc/stats file the running processes count is in the seventh
-  // line and second position [7][1]
-  return stoi(filecontent[7][1]);
+  if (ReadFile(files ? &files->uptime : nullptr, nullptr,
+               path(kUptimeFilename))) {
+    Tokenizer(reader.Content()).NextNumber(snapshot.uptime);
+  }
 }
 
 // DONE: Read and return the command associated with a process
 string LinuxParser::Command(int pid) {
-  string filepath = kProcDirectory + to_string(pid) + kCmdlineFilename;
-  vector<string> linevect = GetLines(filepath);
-  try {
-    return linevect.at(0);
-  } catch (const std::out_of_range &oor) {
+  char path[PATH_MAX];
+  if (!reader.Read(PidPath(path, sizeof(path), pid, kCmdlineFilename)))
     return string();
+  // The arguments in the cmdline file are separated by '\0'
+  string_view content = reader.Content();
+  while (!content.empty() && content.back() == '\0') content.remove_suffix(1);
+  string command(content);
+  std::replace(command.begin(), command.end(), '\0', ' ');
+  return command;
+}
+
+// DONE: Read and return the user ID associated with a process
+int LinuxParser::Uid(int pid) {
+  char path[PATH_MAX];
+  int uid{-1};
+  if (reader.Read(PidPath(path, sizeof(path), pid, kStatusFilename))) {
+    // The Line in which the Uid is found has tab separated content,
+    // the real Uid is the first of them
+    Tokenizer(FindLine(reader.Content(), "Uid:")).NextNumber(uid);
   }
+  return uid;
 }
 
-// DONE: Read and return the memory used by a process
-string LinuxParser::Ram(int pid) {
-  vector<char> removechars{' ', 'k', 'B', '\t'};
-  string filepath = kProcDirectory + to_string(pid) + kStatusFilename;
-  map<string, string> procstatus = GetKVContent(filepath, ':', removechars);
-  float mem_mb{0.0};
-  if (procstatus.count("VmSize")) {
-    mem_mb = stof(procstatus["VmSize"]) / 1000;
+// DONE: Read the CPU times and memory of a process with one read of
+// /proc/<pid>/stat and one of /proc/<pid>/statm, through the fds in files
+// as far as the cache has room for them
+bool LinuxParser::ReadProcessSample(int pid, ProcessSample &sample,
+                                    ProcessFiles *files, FdCache *cache) {
+  // utime, stime, cutime and cstime are fields 14 to 17 and starttime is
+  // field 22 of the stat file, counted from the state as field 3
+  Tokenizer fields{string_view()};
+  if (!PidStatFields(pid, fields, files ? &files->stat : nullptr, cache) ||
+      !fields.Skip(11) || !fields.NextNumber(sample.utime) ||
+      !fields.NextNumber(sample.stime) || !fields.NextNumber(sample.cutime) ||
+      !fields.NextNumber(sample.cstime) || !fields.Skip(4) ||
+      !fields.NextNumber(sample.starttime)) {
+    return false;
+  }
+  // The second field of the statm file is the resident set in pages, the
+  // first one is the virtual size which says little about memory use
+  long rss_pages{0};
+  if (ReadFile(files ? &files->statm : nullptr, cache,
+               [pid](char *buffer, size_t size) {
+                 return PidPath(buffer, size, pid, kStatmFilename);
+               })) {
+    Tokenizer fields(reader.Content());
+    if (fields.Skip(1)) fields.NextNumber(rss_pages);
   }
-  string mem_string = to_string(mem_mb);
-  return mem_string.substr(0, mem_string.find(".") + 2);
+  static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  sample.rss_kb = rss_pages * page_kb;
+  return true;
 }
 
-// DONE: Read and return the user ID associated with a process
-string LinuxParser::Uid(int pid) {
-  vector<char> removechars{' '};
-  string filepath = kProcDirectory + to_string(pid) + kStatusFilename;
-  map<string, string> procstatus = GetKVContent(filepath, ':', removechars);
-  // The Line in which the Uid is found has tab separated content
-  vector<string> linevect = GetLineElements(procstatus["Uid"], '\t');
-  // The Uid is the second element of the created vector
-  string uid;
-  try {
-    uid = linevect.at(1);
-  } catch (const std::out_of_range &oor) {
-    uid = "";
+// DONE: Read the proportional and unique set size of a process. The
+// kernel walks every mapping of the process to produce smaps_rollup, so
+// this is only done for the processes that are shown.
+bool LinuxParser::ReadMemoryDetail(int pid, MemoryDetail &detail) {
+  char path[PATH_MAX];
+  if (!reader.Read(PidPath(path, sizeof(path), pid, kSmapsRollupFilename)))
+    return false;
+  detail = MemoryDetail();
+  long private_clean{0};
+  long private_dirty{0};
+  bool pss{false};
+  Tokenizer lines(reader.Content());
+  string_view line;
+  while (lines.NextLine(line)) {
+    Tokenizer fields(line);
+    string_view key;
+    if (!fields.NextToken(key)) continue;
+    if (key == "Pss:") {
+      pss = fields.NextNumber(detail.pss_kb);
+    } else if (key == "Private_Clean:") {
+      fields.NextNumber(private_clean);
+    } else if (key == "Private_Dirty:") {
+      fields.NextNumber(private_dirty);
+    }
   }
-  return uid;
+  detail.uss_kb = private_clean + private_dirty;
+  return pss;
 }
 
-// DONE: Read and return the user associated with a process
-string LinuxParser::User(int pid) {
-  string uid_str = Uid(pid);
-  // The lines in the /etc/passwd file are ':' separated
-  vector<vector<string>> filecontent = GetSpacedContent(kPasswordPath, ':');
-  // iterating through the lines in the file to find the userid (3rd pos)
-  // and returning the username (1st pos)
-  for (vector<string> &line : filecontent) {
-    if (line[2] == uid_str) {
-      return line[0];
+// The read and write calls (syscr, syscw) are most of the system calls of
+// a tick, the opens, closes and directory reads go along with them
+bool LinuxParser::ReadSelfSample(SelfSample &sample) {
+  string const statm = kSelfDirectory + kStatmFilename;
+  long rss_pages{0};
+  if (!reader.Read(statm.c_str())) return false;
+  Tokenizer pages(reader.Content());
+  if (!pages.Skip(1) || !pages.NextNumber(rss_pages)) return false;
+  static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  sample.rss_kb = rss_pages * page_kb;
+  string const io = kSelfDirectory + kIoFilename;
+  if (!reader.Read(io.c_str())) return false;
+  sample.syscalls = 0;
+  Tokenizer lines(reader.Content());
+  string_view line;
+  while (lines.NextLine(line)) {
+    Tokenizer fields(line);
+    string_view key;
+    long calls{0};
+    if (!fields.NextToken(key)) continue;
+    if ((key == "syscr:" || key == "syscw:") && fields.NextNumber(calls)) {
+      sample.syscalls += calls;
     }
   }
-  return string();
+  return true;
+}
+
+// DONE: Read the CPU times of one thread from /proc/<pid>/task/<tid>/stat,
+// which has the layout of the stat file of a process
+bool LinuxParser::ReadThreadSample(int pid, int tid, ThreadSample &sample) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s%d%s/%d%s", proc_directory.c_str(), pid,
+           kTaskDirectory.c_str(), tid, kStatFilename.c_str());
+  Tokenizer fields{string_view()};
+  return reader.Read(path) && StatFields(fields, &sample.name) &&
+         fields.Skip(11) && fields.NextNumber(sample.utime) &&
+         fields.NextNumber(sample.stime) && fields.Skip(6) &&
+         fields.NextNumber(sample.starttime);
 }
 
-// DONE: Read and return the uptime of a process
-long LinuxParser::UpTime(int pid) {
-  string filepath = kProcDirectory + to_string(pid) + kStatFilename;
-  vector<vector<string>> filecontent = GetSpacedContent(filepath, ' ');
-  // in the proc/<pid>/stat file the uptime since boot in seconds
-  // is in the first line and 22nd position [0][21]
-  vector<string> uptime_line;
-  string uptime_str;
-  try {
-    uptime_line = filecontent.at(0);
-    uptime_str = uptime_line.at(21);
-  } catch (const std::out_of_range &oor) {
-    return 0;
+// DONE: Read the cgroup v2 of a process, the line with hierarchy ID 0 and
+// no controllers in /proc/<pid>/cgroup
+string LinuxParser::Cgroup(int pid) {
+  char path[PATH_MAX];
+  if (!reader.Read(PidPath(path, sizeof(path), pid, kCgroupFilename)))
+    return string();
+  Tokenizer lines(reader.Content());
+  string_view line;
+  while (lines.NextLine(line)) {
+    if (line.substr(0, 3) == "0::") return string(line.substr(3));
   }
-  long uptime_ticks = stol(uptime_str);
-  long uptime_seconds = uptime_ticks / sysconf(_SC_CLK_TCK);
-  return uptime_seconds;
+  return string();
 }
 
-// DONE: Read and return per process CPU utilization
-map<string, float> LinuxParser::CpuUtilization(int pid) {
-  string filepath = kProcDirectory + to_string(pid) + kStatFilename;
-  vector<vector<string>> filecontent = GetSpacedContent(filepath, ' ');
-  map<string, float> procstats;
-  try {
-    vector<string> procstline = filecontent.at(0);
-    float utime = stof(procstline.at(13));
-    float stime = stof(procstline.at(14));
-    float cutime = stof(procstline.at(15));
-    float cstime = stof(procstline.at(16));
-    float starttime = stof(procstline.at(21));
-    // Calculation taken from
-    // https://stackoverflow.com/questions/16726779/how-do-i-get-the-total-cpu-usage-of-an-application-from-proc-pid-stat/16736599#16736599
-    procstats["mhz"] = (float)sysconf(_SC_CLK_TCK);
-    procstats["total_time"] = utime + stime + cutime + cstime;
-    procstats["proc_time"] = UpTime() - (starttime / procstats["mhz"]);
-    procstats["cpu_usage"] =
-        ((procstats["total_time"] / procstats["mhz"]) / procstats["proc_time"]);
-  } catch (const std::out_of_range &oor) {
-    procstats["mhz"] = 0;
-    procstats["total_time"] = 0;
-    procstats["proc_time"] = 0;
-    procstats["cpu_usage"] = 0;
+// DONE: Read the CPU time a cgroup used and the memory it is charged for,
+// one read each of cpu.stat and memory.current
+bool LinuxParser::ReadCgroupSample(string const &cgroup,
+                                   CgroupSample &sample) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s%s%s", cgroup_directory.c_str(),
+           cgroup.c_str(), kCgroupCpuFilename.c_str());
+  if (cgroup_directory.empty() || !reader.Read(path)) return false;
+  if (!Tokenizer(FindLine(reader.Content(), "usage_usec"))
+           .NextNumber(sample.usage_usec))
+    return false;
+  snprintf(path, sizeof(path), "%s%s%s", cgroup_directory.c_str(),
+           cgroup.c_str(), kCgroupMemoryFilename.c_str());
+  long memory_bytes{0};
+  sample.memory_kb = -1;
+  if (reader.Read(path) &&
+      Tokenizer(reader.Content()).NextNumber(memory_bytes)) {
+    sample.memory_kb = memory_bytes / 1024;
   }
-  return procstats;
-}
\ No newline at end of file
+  return true;
+}
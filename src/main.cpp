@@ -1,7 +1,81 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "agent.h"
+#include "aggregator.h"
+#include "collector.h"
+#include "exporter.h"
+#include "headless.h"
+#include "linux_parser.h"
 #include "ncurses_display.h"
+#include "options.h"
+#include "recorder.h"
+#include "replayer.h"
+#include "socket_address.h"
 #include "system.h"
 
-int main() {
-  System system;
-  NCursesDisplay::Display(system);
-}
\ No newline at end of file
+int main(int argc, char* argv[]) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (const std::invalid_argument& error) {
+    std::cerr << error.what() << "\n" << Usage(argv[0]);
+    return 1;
+  }
+  if (options.help) {
+    std::cout << Usage(argv[0]);
+    return 0;
+  }
+  if (!options.replay.empty()) {
+    Replayer replayer(options.replay_speed);
+    if (!replayer.Open(options.replay)) {
+      std::cerr << options.replay << ": not a readable recording\n";
+      return 1;
+    }
+    NCursesDisplay::Display(replayer, options.sort);
+    return 0;
+  }
+  if (!options.aggregate_address.empty()) {
+    SocketAddress address;
+    if (!Socket::ParseAddress(options.aggregate_address, address)) {
+      std::cerr << options.aggregate_address
+                << ": not an address, use [HOST]:PORT or unix:PATH\n";
+      return 1;
+    }
+    Aggregator aggregator;
+    if (!aggregator.Listen(address)) {
+      std::cerr << options.aggregate_address << ": " << strerror(errno)
+                << "\n";
+      return 1;
+    }
+    NCursesDisplay::Display(aggregator, options.sort);
+    return 0;
+  }
+  LinuxParser::SetProcDirectory(options.proc_directory);
+  if (!options.cgroup_directory.empty()) {
+    LinuxParser::SetCgroupDirectory(options.cgroup_directory);
+  }
+  System system(options);
+  Collector collector(system, options.interval);
+  Recorder recorder;
+  if (!options.record.empty()) {
+    if (!recorder.Open(options.record)) {
+      std::cerr << options.record << ": " << strerror(errno) << "\n";
+      return 1;
+    }
+    collector.Record(&recorder);
+  }
+  if (options.headless) {
+    return Headless::Run(collector, options);
+  }
+  if (!options.export_address.empty()) {
+    return Exporter::Run(collector, options);
+  }
+  if (!options.agent_address.empty()) {
+    return Agent::Run(collector, options);
+  }
+  collector.Start();
+  NCursesDisplay::Display(collector, options.sort);
+}
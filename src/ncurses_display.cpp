@@ -2,112 +2,412 @@
 
 #include <curses.h>
 
-#include <chrono>
+#include <algorithm>
+#include <cstdio>
 #include <string>
-#include <thread>
-#include <vector>
+#include <string_view>
 
 #include "format.h"
-#include "system.h"
+#include "overhead.h"
+#include "screen_buffer.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
 
 using std::string;
-using std::to_string;
+using std::string_view;
 
 // 50 bars uniformly displayed from 0 - 100 %
 // 2% is one bar(|)
-std::string NCursesDisplay::ProgressBar(float percent) {
-  std::string result{"0%"};
-  int size{50};
-  float bars{percent * size};
-
+void NCursesDisplay::ProgressBar(ScreenBuffer& screen, int row, int col,
+                                 float percent) {
+  int const size{50};
+  float const bars{percent * size};
+  screen.Put(row, col, "0%", COLOR_PAIR(1));
   for (int i{0}; i < size; ++i) {
-    result += i <= bars ? '|' : ' ';
+    screen.Put(row, col + 2 + i, i <= bars ? '|' : ' ', COLOR_PAIR(1));
   }
+  char display[16];
+  snprintf(display, sizeof(display), " %4.1f/100%%", percent * 100);
+  screen.Put(row, col + 2 + size, display, COLOR_PAIR(1));
+}
 
-  string display{to_string(percent * 100).substr(0, 4)};
-  if (percent < 0.1 || percent == 1.0)
-    display = " " + to_string(percent * 100).substr(0, 3);
-  return result + " " + display + "/100%";
+void NCursesDisplay::DisplaySystem(Snapshot const& snapshot,
+                                   ScreenBuffer& screen) {
+  int row{0};
+  char line[64];
+  screen.Put(++row, 2, "OS: ");
+  screen.Put(row, 6, snapshot.os);
+  screen.Put(++row, 2, "Kernel: ");
+  screen.Put(row, 10, snapshot.kernel);
+  screen.Put(++row, 2, "CPU: ");
+  ProgressBar(screen, row, 10, snapshot.cpu);
+  screen.Put(++row, 2, "Memory: ");
+  ProgressBar(screen, row, 10, snapshot.memory);
+  if (snapshot.short_lived >= 0) {
+    snprintf(line, sizeof(line), "Total Processes: %d (%d short-lived)",
+             snapshot.total_processes, snapshot.short_lived);
+  } else {
+    snprintf(line, sizeof(line), "Total Processes: %d",
+             snapshot.total_processes);
+  }
+  screen.Put(++row, 2, line);
+  snprintf(line, sizeof(line), "Running Processes: %d",
+           snapshot.running_processes);
+  screen.Put(++row, 2, line);
+  screen.Put(++row, 2, "Up Time: " + Format::ElapsedTime(snapshot.uptime));
 }
 
-void NCursesDisplay::DisplaySystem(System& system, WINDOW* window) {
+// Phases are in milliseconds, render_us is the time the last frame took
+void NCursesDisplay::DisplayOverhead(Snapshot const& snapshot,
+                                     ScreenBuffer& screen, long render_us) {
   int row{0};
-  mvwprintw(window, ++row, 2, ("OS: " + system.OperatingSystem()).c_str());
-  mvwprintw(window, ++row, 2, ("Kernel: " + system.Kernel()).c_str());
-  mvwprintw(window, ++row, 2, "CPU: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.Cpu().Utilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2, "Memory: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryUtilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2,
-            ("Total Processes: " + to_string(system.TotalProcesses())).c_str());
-  mvwprintw(
-      window, ++row, 2,
-      ("Running Processes: " + to_string(system.RunningProcesses())).c_str());
-  mvwprintw(window, ++row, 2,
-            ("Up Time: " + Format::ElapsedTime(system.UpTime())).c_str());
-  wrefresh(window);
+  char line[64];
+  PhaseTimes const& phases = snapshot.phases;
+  SelfUsage const& self = snapshot.self;
+  screen.Put(++row, 2, "Monitor", COLOR_PAIR(2));
+  if (self.cpu >= 0) {
+    snprintf(line, sizeof(line), "CPU: %.2f%%", self.cpu * 100);
+    screen.Put(++row, 2, line);
+  } else {
+    screen.Put(++row, 2, "CPU: -");
+  }
+  screen.Put(++row, 2, "RSS[MB]: ");
+  screen.Put(row, 11, self.rss_kb < 0 ? "-" : Format::Megabytes(self.rss_kb));
+  if (self.syscalls >= 0) {
+    snprintf(line, sizeof(line), "Syscalls/tick: %ld", self.syscalls);
+    screen.Put(++row, 2, line);
+  } else {
+    screen.Put(++row, 2, "Syscalls/tick: -");
+  }
+  row = 0;
+  int const column{30};
+  screen.Put(++row, column, "Tick phases [ms]", COLOR_PAIR(2));
+  snprintf(line, sizeof(line), "Scan:   %9.3f", phases.scan_us / 1000.0);
+  screen.Put(++row, column, line);
+  snprintf(line, sizeof(line), "Sample: %9.3f", phases.sample_us / 1000.0);
+  screen.Put(++row, column, line);
+  snprintf(line, sizeof(line), "Sort:   %9.3f", phases.sort_us / 1000.0);
+  screen.Put(++row, column, line);
+  snprintf(line, sizeof(line), "Render: %9.3f", render_us / 1000.0);
+  screen.Put(++row, column, line);
 }
 
-void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
-                                      WINDOW* window, int n) {
+// Shows n lines of processes, the threads of an expanded process are
+// listed below it, hottest first. Returns how many processes fit.
+int NCursesDisplay::DisplayProcesses(Snapshot const& snapshot,
+                                     ScreenBuffer& screen, int n,
+                                     int selected, string_view filter) {
   int row{0};
   int const pid_column{2};
-  int const user_column{9};
-  int const cpu_column{24};
-  int const ram_column{34};
-  int const time_column{43};
-  int const command_column{54};
-  wattron(window, COLOR_PAIR(2));
-  mvwprintw(window, ++row, pid_column, "PID");
-  mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU[%%]");
-  mvwprintw(window, row, ram_column, "RAM[MB]");
-  mvwprintw(window, row, time_column, "TIME+");
-  mvwprintw(window, row, command_column, "COMMAND");
-  wattroff(window, COLOR_PAIR(2));
-  int const num_processes = int(processes.size()) > n ? n : processes.size();
-  for (int i = 0; i < num_processes; ++i) {
-    mvwprintw(window, ++row, pid_column, to_string(processes[i].Pid()).c_str());
-    mvwprintw(window, row, user_column, processes[i].User().c_str());
-    float cpu = processes[i].CpuUtilization() * 100;
-    mvwprintw(window, row, cpu_column, to_string(cpu).substr(0, 4).c_str());
-    mvwprintw(window, row, ram_column, processes[i].Ram().c_str());
-    mvwprintw(window, row, time_column,
-              Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column,
-              processes[i].Command().substr(0, window->_maxx - 54).c_str());
+  // Processes of several hosts get a host column after the PID
+  int const host_column{9};
+  int const shift{snapshot.hosts ? 16 : 0};
+  int const user_column{9 + shift};
+  int const cpu_column{24 + shift};
+  int const ram_column{32 + shift};
+  int const pss_column{41 + shift};
+  int const uss_column{50 + shift};
+  int const time_column{59 + shift};
+  int const command_column{70 + shift};
+  // Underline the column the processes are ordered by
+  auto header = [&](SortKey key) {
+    return COLOR_PAIR(2) | (key == snapshot.key ? A_UNDERLINE : A_NORMAL);
+  };
+  screen.Put(++row, pid_column, "PID", header(SortKey::kPid));
+  if (snapshot.hosts) screen.Put(row, host_column, "HOST", COLOR_PAIR(2));
+  screen.Put(row, user_column, "USER", header(SortKey::kUser));
+  screen.Put(row, cpu_column, "CPU[%]", header(SortKey::kCpu));
+  screen.Put(row, ram_column, "RSS[MB]", header(SortKey::kMemory));
+  screen.Put(row, pss_column, "PSS[MB]", COLOR_PAIR(2));
+  screen.Put(row, uss_column, "USS[MB]", COLOR_PAIR(2));
+  screen.Put(row, time_column, "TIME+", header(SortKey::kUptime));
+  screen.Put(row, command_column, "COMMAND", COLOR_PAIR(2));
+  // Where the rows are in the list, and the filter that made the list
+  char position[48];
+  int const length = snprintf(
+      position, sizeof(position), "%zu-%zu/%zu ",
+      std::min(snapshot.first + 1, snapshot.process_count),
+      snapshot.first + snapshot.rows.size(), snapshot.process_count);
+  screen.Put(row, command_column + 9, position);
+  screen.Put(row, command_column + 9 + length, filter, COLOR_PAIR(1));
+  int const last_row = row + n;
+  int shown{0};
+  char field[32];
+  for (ProcessRow const& process : snapshot.rows) {
+    if (row == last_row) break;
+    snprintf(field, sizeof(field), "%d", process.pid);
+    screen.Put(++row, pid_column, field);
+    // Fields are cut off where the next column starts
+    if (snapshot.hosts) {
+      string_view host(process.host);
+      screen.Put(row, host_column,
+                 host.substr(0, user_column - host_column - 1));
+    }
+    string_view user(process.user);
+    screen.Put(row, user_column, user.substr(0, cpu_column - user_column - 1));
+    if (process.warming) {
+      screen.Put(row, cpu_column, "warming");
+    } else {
+      snprintf(field, sizeof(field), "%.2f", process.cpu * 100);
+      screen.Put(row, cpu_column, field);
+    }
+    screen.Put(row, ram_column, Format::Megabytes(process.ram_kb));
+    screen.Put(row, pss_column,
+               process.pss_kb < 0 ? "-" : Format::Megabytes(process.pss_kb));
+    screen.Put(row, uss_column,
+               process.uss_kb < 0 ? "-" : Format::Megabytes(process.uss_kb));
+    screen.Put(row, time_column, Format::ElapsedTime(process.uptime));
+    screen.Put(row, command_column - 2, process.expanded ? '-' : ' ');
+    screen.Put(row, command_column, process.command);
+    if (shown++ == selected) screen.Highlight(row, A_REVERSE);
+    for (ThreadRow const& thread : process.threads) {
+      if (row == last_row) break;
+      snprintf(field, sizeof(field), "%d", thread.tid);
+      screen.Put(++row, pid_column, field);
+      snprintf(field, sizeof(field), "%.2f", thread.cpu * 100);
+      screen.Put(row, cpu_column, field);
+      screen.Put(row, command_column, "|- ");
+      screen.Put(row, command_column + 3, thread.name);
+    }
   }
+  return shown;
 }
 
-void NCursesDisplay::Display(System& system, int n) {
+// Shows n lines of cgroups in place of the processes
+void NCursesDisplay::DisplayCgroups(Snapshot const& snapshot,
+                                    ScreenBuffer& screen, int n) {
+  int row{0};
+  int const cpu_column{2};
+  int const memory_column{11};
+  int const processes_column{20};
+  int const path_column{28};
+  auto header = [&](SortKey key) {
+    return COLOR_PAIR(2) | (key == snapshot.key ? A_UNDERLINE : A_NORMAL);
+  };
+  screen.Put(++row, cpu_column, "CPU[%]", header(SortKey::kCpu));
+  screen.Put(row, memory_column, "MEM[MB]", header(SortKey::kMemory));
+  screen.Put(row, processes_column, "PROCS", COLOR_PAIR(2));
+  screen.Put(row, path_column, "CGROUP", COLOR_PAIR(2));
+  int const last_row = row + n;
+  char field[32];
+  for (CgroupRow const& cgroup : snapshot.cgroups) {
+    if (row == last_row) break;
+    snprintf(field, sizeof(field), "%.2f", cgroup.cpu * 100);
+    screen.Put(++row, cpu_column, field);
+    screen.Put(row, memory_column, cgroup.memory_kb < 0
+                                       ? "-"
+                                       : Format::Megabytes(cgroup.memory_kb));
+    snprintf(field, sizeof(field), "%d", cgroup.processes);
+    screen.Put(row, processes_column, field);
+    screen.Put(row, path_column, cgroup.path);
+  }
+}
+
+// Keys that switch the column the processes are ordered by
+bool NCursesDisplay::SortKeyFor(int input, SortKey& key) {
+  switch (input) {
+    case 'c':
+      key = SortKey::kCpu;
+      return true;
+    case 'm':
+      key = SortKey::kMemory;
+      return true;
+    case 'p':
+      key = SortKey::kPid;
+      return true;
+    case 't':
+      key = SortKey::kUptime;
+      return true;
+    case 'u':
+      key = SortKey::kUser;
+      return true;
+  }
+  return false;
+}
+
+// Renders the latest snapshot of the source. Live sampling runs on the
+// collector thread, so the display stays responsive during slow scans and
+// only redraws when a new snapshot or a key press comes in. The windows
+// are boxed once per size, a frame only sends the cells that changed.
+// The process list fills the terminal and scrolls; the source is only
+// asked for the rows in view, so only those are copied and resolved.
+void NCursesDisplay::Display(SnapshotSource& source, SortKey key) {
   initscr();      // start ncurses
   noecho();       // do not print input values
   cbreak();       // terminate ncurses on ctrl + c
   start_color();  // enable color
+  init_pair(1, COLOR_BLUE, COLOR_BLACK);
+  init_pair(2, COLOR_GREEN, COLOR_BLACK);
 
-  int x_max{getmaxx(stdscr)};
-  WINDOW* system_window = newwin(9, x_max - 1, 0, 0);
+  int const system_rows{9};
+  WINDOW* system_window = newwin(system_rows, COLS - 1, 0, 0);
   WINDOW* process_window =
-      newwin(3 + n, x_max - 1, system_window->_maxy + 1, 0);
-
-  while (1) {
-    init_pair(1, COLOR_BLUE, COLOR_BLACK);
-    init_pair(2, COLOR_GREEN, COLOR_BLACK);
+      newwin(std::max(3, LINES - system_rows), COLS - 1, system_rows, 0);
+  ScreenBuffer system_screen;
+  ScreenBuffer process_screen;
+  // The process list gets every line below the system values, less its
+  // header and border. Called again whenever the terminal is resized.
+  int n{0};
+  auto layout = [&] {
+    wresize(system_window, system_rows, std::max(2, COLS - 1));
+    wresize(process_window, std::max(3, LINES - system_rows),
+            std::max(2, COLS - 1));
+    mvwin(process_window, system_rows, 0);
+    // The column right of the windows keeps whatever was drawn there
+    werase(stdscr);
+    wnoutrefresh(stdscr);
+    werase(system_window);
+    werase(process_window);
     box(system_window, 0, 0);
     box(process_window, 0, 0);
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, n);
-    wrefresh(system_window);
-    wrefresh(process_window);
-    refresh();
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    werase(process_window);
+    clearok(curscr, TRUE);
+    system_screen.Resize(getmaxy(system_window), getmaxx(system_window));
+    process_screen.Resize(getmaxy(process_window), getmaxx(process_window));
+    n = std::max(1, getmaxy(process_window) - 3);
+  };
+  layout();
+
+  keypad(process_window, TRUE);
+
+  // The selection is a position in the whole list and follows its
+  // process when the order changes; first is the top row in view
+  std::size_t selected{0};
+  std::size_t first{0};
+  int selected_pid{-1};
+  int shown{0};
+  bool moved{false};
+  // The cgroup view has no selection, it keeps the one of the processes
+  bool cgroups{false};
+  bool toggled{false};
+  // The debug pane takes the place of the system values
+  bool debug{false};
+  // Keys go into the filter while it is edited
+  string query;
+  bool editing{false};
+  long render_us{0};
+  source.Request(key, n, first);
+  while (1) {
+    bool fresh;
+    Snapshot const& snapshot = source.Latest(&fresh);
+    if (fresh || moved || toggled) {
+      for (size_t i = 0; i < snapshot.rows.size(); ++i) {
+        if (snapshot.rows[i].pid == selected_pid) {
+          selected = snapshot.first + i;
+        }
+      }
+      PhaseTimer timer;
+      system_screen.Clear();
+      if (debug) {
+        DisplayOverhead(snapshot, system_screen, render_us);
+      } else {
+        DisplaySystem(snapshot, system_screen);
+      }
+      system_screen.Flush(system_window);
+      process_screen.Clear();
+      if (cgroups) {
+        DisplayCgroups(snapshot, process_screen, n);
+      } else {
+        string const filter =
+            editing ? "/" + query + "_" : query.empty() ? "" : "/" + query;
+        int const row = int(selected) - int(snapshot.first);
+        shown = DisplayProcesses(snapshot, process_screen, n, row, filter);
+      }
+      process_screen.Flush(process_window);
+      wnoutrefresh(system_window);
+      wnoutrefresh(process_window);
+      doupdate();
+      render_us = timer.Lap();
+      moved = false;
+      toggled = false;
+    }
+    // Keep the selection in the list and the list around the selection,
+    // rows taken by threads included
+    std::size_t const count = snapshot.process_count;
+    if (selected >= count) selected = count > 0 ? count - 1 : 0;
+    std::size_t view = first;
+    if (selected < view) view = selected;
+    if (selected >= view + n) view = selected - n + 1;
+    if (view == first && snapshot.first == first && !cgroups && shown > 0 &&
+        selected >= first + shown) {
+      view = selected - shown + 1;
+    }
+    if (view != first) {
+      first = view;
+      source.Request(key, n, first);
+    }
+    bool const in_view = selected >= snapshot.first &&
+                         selected < snapshot.first + snapshot.rows.size();
+    ProcessRow const* current =
+        in_view ? &snapshot.rows[selected - snapshot.first] : nullptr;
+    if (current != nullptr) selected_pid = current->pid;
+
+    // Poll for new snapshots while waiting for keys
+    wtimeout(process_window, 50);
+    int input = wgetch(process_window);
+    if (input == KEY_RESIZE) {
+      layout();
+      source.Request(key, n, first);
+      toggled = true;
+      continue;
+    }
+    if (editing) {
+      if (input == '\n' || input == KEY_ENTER) {
+        editing = false;
+      } else if (input == 27) {
+        // Escape drops the filter
+        query.clear();
+        editing = false;
+      } else if (input == KEY_BACKSPACE || input == 127 || input == 8) {
+        if (!query.empty()) query.pop_back();
+      } else if (input >= ' ' && input < 127) {
+        query += char(input);
+      } else {
+        continue;
+      }
+      source.Filter(query);
+      toggled = true;
+      continue;
+    }
+    if (input == 'q') break;
+    if (input == '/' && !cgroups && source.Filter(query)) {
+      editing = true;
+      toggled = true;
+      continue;
+    }
+    if (SortKeyFor(input, key)) source.Request(key, n, first);
+    if (input == 'g') {
+      cgroups = !cgroups;
+      toggled = true;
+    } else if (input == 'd') {
+      debug = !debug;
+      toggled = true;
+    }
+    if (cgroups) continue;
+    std::size_t const page = n;
+    std::size_t const last = count > 0 ? count - 1 : 0;
+    std::size_t target = selected;
+    if (input == KEY_UP && selected > 0) {
+      target = selected - 1;
+    } else if (input == KEY_DOWN) {
+      target = std::min(selected + 1, last);
+    } else if (input == KEY_PPAGE) {
+      target = selected > page ? selected - page : 0;
+    } else if (input == KEY_NPAGE) {
+      target = std::min(selected + page, last);
+    } else if (input == KEY_HOME) {
+      target = 0;
+    } else if (input == KEY_END) {
+      target = last;
+    } else if ((input == 'e' || input == '\n' || input == KEY_ENTER) &&
+               current != nullptr) {
+      source.Expand(current->pid, !current->expanded);
+    }
+    // The selection leaves its process behind until the next redraw
+    if (target != selected) {
+      selected = target;
+      selected_pid = -1;
+      moved = true;
+    }
   }
   endwin();
 }
@@ -0,0 +1,221 @@
+#include "options.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "filter_index.h"
+#include "proc_reader.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+// Returns the value following an option, throws if there is none
+string_view Value(int argc, char* argv[], int& i) {
+  if (i + 1 >= argc) {
+    throw std::invalid_argument(string(argv[i]) + " needs a value");
+  }
+  return argv[++i];
+}
+
+template <typename T>
+T Number(string_view option, string_view value) {
+  T number;
+  if (!ParseNumber(value, number)) {
+    throw std::invalid_argument(string(option) + ": not a number: " +
+                                string(value));
+  }
+  return number;
+}
+}  // namespace
+
+Options ParseOptions(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    string_view option(argv[i]);
+    if (option == "--help" || option == "-h") {
+      options.help = true;
+    } else if (option == "--threads") {
+      options.threads = Number<unsigned>(option, Value(argc, argv, i));
+    } else if (option == "--proc-root") {
+      options.proc_directory = string(Value(argc, argv, i));
+    } else if (option == "--cgroup-root") {
+      options.cgroup_directory = string(Value(argc, argv, i));
+    } else if (option == "--cpu-mode") {
+      string_view mode = Value(argc, argv, i);
+      if (mode == "window") {
+        options.history.mode = UtilizationMode::kSlidingWindow;
+      } else if (mode == "ewma") {
+        options.history.mode = UtilizationMode::kEwma;
+      } else {
+        throw std::invalid_argument("--cpu-mode must be window or ewma");
+      }
+    } else if (option == "--cpu-window") {
+      options.history.window = Number<size_t>(option, Value(argc, argv, i));
+      if (options.history.window < 1 ||
+          options.history.window > CpuHistory::kMaxWindow) {
+        throw std::invalid_argument("--cpu-window must be between 1 and " +
+                                    std::to_string(CpuHistory::kMaxWindow));
+      }
+    } else if (option == "--cpu-alpha") {
+      options.history.alpha = Number<float>(option, Value(argc, argv, i));
+      if (!(options.history.alpha > 0 && options.history.alpha <= 1)) {
+        throw std::invalid_argument("--cpu-alpha must be in (0, 1]");
+      }
+    } else if (option == "--idle-interval") {
+      options.idle_interval = Number<unsigned>(option, Value(argc, argv, i));
+      if (options.idle_interval < 1) {
+        throw std::invalid_argument("--idle-interval must be at least 1");
+      }
+    } else if (option == "--interval") {
+      long interval = Number<long>(option, Value(argc, argv, i));
+      if (interval < 1) {
+        throw std::invalid_argument("--interval must be at least 1 ms");
+      }
+      options.interval = std::chrono::milliseconds(interval);
+    } else if (option == "--sort") {
+      string_view key = Value(argc, argv, i);
+      if (key == "cpu") {
+        options.sort = SortKey::kCpu;
+      } else if (key == "memory") {
+        options.sort = SortKey::kMemory;
+      } else if (key == "pid") {
+        options.sort = SortKey::kPid;
+      } else if (key == "time") {
+        options.sort = SortKey::kUptime;
+      } else if (key == "user") {
+        options.sort = SortKey::kUser;
+      } else {
+        throw std::invalid_argument(
+            "--sort must be cpu, memory, pid, time or user");
+      }
+    } else if (option == "--filter") {
+      options.filter = string(Value(argc, argv, i));
+      ProcessFilter filter;
+      if (!ProcessFilter::Parse(options.filter, filter)) {
+        throw std::invalid_argument(
+            "--filter takes user=NAME, pid=N, pid=FROM-TO and words of the "
+            "command");
+      }
+    } else if (option == "--proc-events") {
+      options.proc_events = true;
+    } else if (option == "--headless") {
+      options.headless = true;
+    } else if (option == "--format") {
+      string_view format = Value(argc, argv, i);
+      if (format == "ndjson") {
+        options.format = OutputFormat::kNdjson;
+      } else if (format == "csv") {
+        options.format = OutputFormat::kCsv;
+      } else {
+        throw std::invalid_argument("--format must be ndjson or csv");
+      }
+    } else if (option == "--output") {
+      options.output = string(Value(argc, argv, i));
+    } else if (option == "--top") {
+      options.top = Number<size_t>(option, Value(argc, argv, i));
+    } else if (option == "--count") {
+      options.count = Number<unsigned long>(option, Value(argc, argv, i));
+    } else if (option == "--export") {
+      options.export_address = string(Value(argc, argv, i));
+    } else if (option == "--agent") {
+      options.agent_address = string(Value(argc, argv, i));
+    } else if (option == "--aggregate") {
+      options.aggregate_address = string(Value(argc, argv, i));
+    } else if (option == "--record") {
+      options.record = string(Value(argc, argv, i));
+    } else if (option == "--replay") {
+      options.replay = string(Value(argc, argv, i));
+    } else if (option == "--speed") {
+      options.replay_speed = Number<double>(option, Value(argc, argv, i));
+      if (!(options.replay_speed > 0)) {
+        throw std::invalid_argument("--speed must be above 0");
+      }
+    } else {
+      throw std::invalid_argument("unknown option " + string(option));
+    }
+  }
+  if (!options.replay.empty() &&
+      (options.headless || !options.record.empty() ||
+       !options.export_address.empty())) {
+    throw std::invalid_argument(
+        "--replay shows a recording and takes no --headless, --export or "
+        "--record");
+  }
+  if (options.headless && !options.export_address.empty()) {
+    throw std::invalid_argument("--headless and --export exclude each other");
+  }
+  if (!options.agent_address.empty() &&
+      (options.headless || !options.export_address.empty() ||
+       !options.record.empty() || !options.replay.empty())) {
+    throw std::invalid_argument(
+        "--agent streams the samples and takes no --headless, --export, "
+        "--record or --replay");
+  }
+  if (!options.aggregate_address.empty() &&
+      (options.headless || !options.export_address.empty() ||
+       !options.record.empty() || !options.replay.empty() ||
+       !options.agent_address.empty())) {
+    throw std::invalid_argument(
+        "--aggregate shows the agents and takes no --headless, --export, "
+        "--record, --replay or --agent");
+  }
+  return options;
+}
+
+string Usage(string const& program) {
+  return "usage: " + program +
+         " [options]\n"
+         "  --help            show this help\n"
+         "  --threads N       worker threads sampling processes (default: one "
+         "per core)\n"
+         "  --proc-root DIR   read procfs from DIR (default: /proc/)\n"
+         "  --cgroup-root DIR read the cgroup v2 hierarchy from DIR "
+         "(default:\n"
+         "                    /sys/fs/cgroup or /sys/fs/cgroup/unified)\n"
+         "  --cpu-mode M      process CPU averaging, window or ewma (default: "
+         "window)\n"
+         "  --cpu-window N    ticks of the sliding window, 1 to 15 (default: "
+         "10)\n"
+         "  --cpu-alpha A     weight of the latest tick for ewma (default: "
+         "0.3)\n"
+         "  --idle-interval N most ticks between samples of an idle process, "
+         "1 samples\n"
+         "                    every process every tick, bounded by the CPU "
+         "window\n"
+         "                    (default: 16)\n"
+         "  --interval MS     time between two samples (default: 1000)\n"
+         "  --sort KEY        order processes by cpu, memory, pid, time or "
+         "user (default: cpu)\n"
+         "  --filter QUERY    only show processes matching all of QUERY: "
+         "user=NAME,\n"
+         "                    pid=N or pid=FROM-TO and text in the command "
+         "(/ in the\n"
+         "                    display)\n"
+         "  --proc-events     track processes through the netlink proc "
+         "connector,\n"
+         "                    needs CAP_NET_ADMIN, scans /proc otherwise\n"
+         "  --headless        stream samples instead of starting the display\n"
+         "  --format F        headless output, ndjson or csv (default: "
+         "ndjson)\n"
+         "  --output FILE     headless output file (default: stdout)\n"
+         "  --top K           processes per headless sample (default: 10)\n"
+         "  --count N         headless samples to write, 0 is unlimited "
+         "(default: 0)\n"
+         "  --export ADDR     serve the samples in the Prometheus text format "
+         "on\n"
+         "                    [HOST]:PORT (HOST defaults to 127.0.0.1) or "
+         "unix:PATH,\n"
+         "                    with --top processes per sample\n"
+         "  --agent ADDR      stream the changes of every sample to an "
+         "aggregator on\n"
+         "                    [HOST]:PORT or unix:PATH instead of starting "
+         "the display\n"
+         "  --aggregate ADDR  show the processes of all agents streaming to "
+         "ADDR\n"
+         "  --record FILE     append every sample to a recording\n"
+         "  --replay FILE     show a recording instead of the live system\n"
+         "  --speed X         replay speed, 2 plays twice as fast (default: "
+         "1)\n";
+}
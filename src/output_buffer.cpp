@@ -0,0 +1,146 @@
+#include "output_buffer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+using std::string_view;
+
+// Overlong forms and surrogates are no valid sequences either
+std::size_t Utf8Length(string_view text) {
+  if (text.empty()) return 0;
+  unsigned char const lead = text[0];
+  if (lead < 0x80) return 1;
+  std::size_t length;
+  unsigned char low{0x80}, high{0xbf};
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    length = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    length = 3;
+    if (lead == 0xe0) low = 0xa0;
+    if (lead == 0xed) high = 0x9f;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    length = 4;
+    if (lead == 0xf0) low = 0x90;
+    if (lead == 0xf4) high = 0x8f;
+  } else {
+    return 0;
+  }
+  if (text.size() < length) return 0;
+  for (std::size_t i = 1; i < length; ++i) {
+    unsigned char const c = text[i];
+    if (c < low || c > high) return 0;
+    low = 0x80;
+    high = 0xbf;
+  }
+  return length;
+}
+
+OutputBuffer::OutputBuffer(int fd) : fd_(fd) {}
+
+OutputBuffer::~OutputBuffer() { Flush(); }
+
+// Makes room for size bytes, flushing first if they do not fit anymore
+char* OutputBuffer::Reserve(std::size_t size) {
+  if (buffer_.size() - size_ < size) Flush();
+  return buffer_.data() + size_;
+}
+
+void OutputBuffer::Append(string_view text) {
+  while (!text.empty()) {
+    if (size_ == buffer_.size()) Flush();
+    std::size_t count = std::min(text.size(), buffer_.size() - size_);
+    memcpy(buffer_.data() + size_, text.data(), count);
+    size_ += count;
+    text.remove_prefix(count);
+  }
+}
+
+void OutputBuffer::Append(char c) {
+  *Reserve(1) = c;
+  ++size_;
+}
+
+void OutputBuffer::Append(long number) {
+  char* begin = Reserve(kNumberSize);
+  size_ += std::to_chars(begin, begin + kNumberSize, number).ptr - begin;
+}
+
+void OutputBuffer::Append(double number, int decimals) {
+  char* begin = Reserve(kNumberSize);
+  std::to_chars_result result = std::to_chars(
+      begin, begin + kNumberSize, number, std::chars_format::fixed, decimals);
+  if (result.ec == std::errc()) size_ += result.ptr - begin;
+}
+
+// Bytes that are no valid UTF-8, which command lines and paths may hold,
+// are escaped one by one as if they were Latin-1, so every line stays
+// valid JSON
+void OutputBuffer::AppendJson(string_view text) {
+  static char const kHex[] = "0123456789abcdef";
+  Append('"');
+  for (std::size_t i = 0; i < text.size();) {
+    unsigned char const c = text[i];
+    std::size_t const length = c < 0x80 ? 1 : Utf8Length(text.substr(i));
+    if (length > 1) {
+      Append(text.substr(i, length));
+      i += length;
+      continue;
+    }
+    ++i;
+    switch (c) {
+      case '"':
+        Append("\\\"");
+        break;
+      case '\\':
+        Append("\\\\");
+        break;
+      case '\n':
+        Append("\\n");
+        break;
+      case '\t':
+        Append("\\t");
+        break;
+      default:
+        if (c < 0x20 || c >= 0x80) {
+          char escape[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+          Append(string_view(escape, sizeof(escape)));
+        } else {
+          Append(char(c));
+        }
+    }
+  }
+  Append('"');
+}
+
+void OutputBuffer::AppendCsv(string_view text) {
+  if (text.find_first_of(",\"\n\r") == string_view::npos) {
+    Append(text);
+    return;
+  }
+  Append('"');
+  for (char c : text) {
+    if (c == '"') Append('"');
+    Append(c);
+  }
+  Append('"');
+}
+
+bool OutputBuffer::Flush() {
+  std::size_t written = 0;
+  while (!failed_ && written < size_) {
+    ssize_t count = write(fd_, buffer_.data() + written, size_ - written);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      failed_ = true;
+      break;
+    }
+    written += count;
+  }
+  size_ = 0;
+  return !failed_;
+}
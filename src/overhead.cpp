@@ -0,0 +1,50 @@
+#include "overhead.h"
+
+#include <sys/resource.h>
+
+#include <chrono>
+
+#include "linux_parser.h"
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+PhaseTimer::PhaseTimer() : last_(steady_clock::now()) {}
+
+long PhaseTimer::Lap() {
+  steady_clock::time_point const now = steady_clock::now();
+  long const elapsed =
+      std::chrono::duration_cast<microseconds>(now - last_).count();
+  last_ = now;
+  return elapsed;
+}
+
+// The first update only takes the counters, usage is per tick from the
+// second one on
+SelfUsage const& SelfMonitor::Update() {
+  steady_clock::time_point const now = steady_clock::now();
+  rusage self;
+  long cpu_us{-1};
+  if (getrusage(RUSAGE_SELF, &self) == 0) {
+    cpu_us = (self.ru_utime.tv_sec + self.ru_stime.tv_sec) * 1000000L +
+             self.ru_utime.tv_usec + self.ru_stime.tv_usec;
+  }
+  long const wall_us =
+      std::chrono::duration_cast<microseconds>(now - last_time_).count();
+  usage_.cpu = cpu_us >= 0 && last_cpu_us_ >= 0 && wall_us > 0
+                   ? float(cpu_us - last_cpu_us_) / wall_us
+                   : -1;
+  last_cpu_us_ = cpu_us;
+  last_time_ = now;
+
+  LinuxParser::SelfSample sample;
+  if (LinuxParser::ReadSelfSample(sample)) {
+    usage_.rss_kb = sample.rss_kb;
+    usage_.syscalls =
+        last_syscalls_ >= 0 ? sample.syscalls - last_syscalls_ : -1;
+    last_syscalls_ = sample.syscalls;
+  } else {
+    usage_.rss_kb = usage_.syscalls = last_syscalls_ = -1;
+  }
+  return usage_;
+}
@@ -0,0 +1,240 @@
+#include "pid_source.h"
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "linux_parser.h"
+#include "process_table.h"
+
+using std::vector;
+
+namespace {
+// Room for a few hundred events per receive call
+constexpr size_t kReceiveBuffer{16384};
+// Kernel side queue, a fork storm between two ticks should fit into it
+constexpr int kSocketBuffer{1 << 20};
+// How long the kernel gets to answer the subscription
+constexpr std::chrono::milliseconds kAckTimeout{500};
+// Ticks between two scans while listening. Events can get lost without
+// the queue overflowing, e.g. when the connector fails to allocate them.
+constexpr uint32_t kRescanTicks{64};
+
+// Tells the acks to our control messages apart from those of other
+// listeners, acks go out to every socket in the group. The kernel answers
+// with the ack number of the message plus one.
+uint32_t AckNumber() { return getpid(); }
+
+// Sends PROC_CN_MCAST_LISTEN or PROC_CN_MCAST_IGNORE to the connector
+bool SendControl(int socket, proc_cn_mcast_op op) {
+  constexpr size_t kSize = NLMSG_SPACE(sizeof(cn_msg) + sizeof(op));
+  alignas(nlmsghdr) char buffer[kSize] = {};
+  nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer);
+  header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(op));
+  header->nlmsg_type = NLMSG_DONE;
+  header->nlmsg_pid = getpid();
+  cn_msg* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+  message->id.idx = CN_IDX_PROC;
+  message->id.val = CN_VAL_PROC;
+  message->ack = AckNumber();
+  message->len = sizeof(op);
+  std::memcpy(message->data, &op, sizeof(op));
+  return send(socket, buffer, header->nlmsg_len, 0) ==
+         ssize_t(header->nlmsg_len);
+}
+}  // namespace
+
+// The listener only makes sense for the live /proc, a copy of it has no
+// events. Subscribing before the first scan makes sure that no process
+// falls between the two. Without events every tick scans anyway.
+PidSource::PidSource(bool listen) {
+  if (listen && LinuxParser::ProcDirectory() == "/proc/" && !Subscribe()) {
+    Unsubscribe();
+  }
+  if (Listening()) {
+    Scan();
+    ++generation_;
+  }
+}
+
+PidSource::~PidSource() {
+  if (socket_ >= 0) SendControl(socket_, PROC_CN_MCAST_IGNORE);
+  Unsubscribe();
+}
+
+bool PidSource::Subscribe() {
+  socket_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                   NETLINK_CONNECTOR);
+  if (socket_ < 0) return false;
+  // Forcing the size needs the same privilege as the subscription itself
+  int size = kSocketBuffer;
+  if (setsockopt(socket_, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) <
+      0) {
+    setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  }
+  sockaddr_nl address = {};
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = CN_IDX_PROC;
+  address.nl_pid = 0;
+  if (bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+      0) {
+    return false;
+  }
+  return SendControl(socket_, PROC_CN_MCAST_LISTEN) && AwaitAck();
+}
+
+// Neither bind nor send need the privilege, the kernel refuses the
+// subscription with an error in its ack, e.g. inside a user namespace.
+// Events that come before the ack are covered by the first scan.
+bool PidSource::AwaitAck() {
+  auto const deadline = std::chrono::steady_clock::now() + kAckTimeout;
+  alignas(nlmsghdr) char buffer[kReceiveBuffer];
+  while (true) {
+    auto const left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    pollfd polled{socket_, POLLIN, 0};
+    if (left.count() <= 0 || poll(&polled, 1, left.count()) == 0) return false;
+    ssize_t count = recv(socket_, buffer, sizeof(buffer), 0);
+    if (count < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ||
+          errno == ENOBUFS) {
+        continue;
+      }
+      return false;
+    }
+    int length = count;
+    for (nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer);
+         NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+      if (header->nlmsg_type == NLMSG_ERROR ||
+          header->nlmsg_type == NLMSG_NOOP) {
+        continue;
+      }
+      cn_msg const* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+      proc_event const* event =
+          reinterpret_cast<proc_event const*>(message->data);
+      if (message->id.idx == CN_IDX_PROC && message->id.val == CN_VAL_PROC &&
+          event->what == proc_event::PROC_EVENT_NONE &&
+          message->ack == AckNumber() + 1) {
+        return event->event_data.ack.err == 0;
+      }
+    }
+  }
+}
+
+// Every later tick scans, what was kept to apply events is let go
+void PidSource::Unsubscribe() {
+  if (socket_ >= 0) close(socket_);
+  socket_ = -1;
+  index_ = PidIndex();
+  vector<uint32_t>().swap(born_);
+}
+
+// DONE: Hand out the PIDs of this tick. A fork and an exit in the same
+// drain belong to a process that no scan would ever have seen. Every few
+// ticks a scan follows the drain, in case events went missing unnoticed.
+vector<int> const& PidSource::Pids() {
+  execs_.clear();
+  short_lived_ = 0;
+  if (socket_ < 0 || !Drain() || generation_ % kRescanTicks == 0) Scan();
+  ++generation_;
+  return pids_;
+}
+
+vector<int> const& PidSource::Execs() const { return execs_; }
+
+int PidSource::ShortLived() const { return socket_ < 0 ? -1 : short_lived_; }
+
+bool PidSource::Listening() const { return socket_ >= 0; }
+
+// Applies the queued events, returns false if the set can no longer be
+// trusted because the kernel dropped events or the socket failed
+bool PidSource::Drain() {
+  alignas(nlmsghdr) char buffer[kReceiveBuffer];
+  while (true) {
+    ssize_t count = recv(socket_, buffer, sizeof(buffer), 0);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+      // ENOBUFS: the queue overflowed, a scan catches up and the
+      // listener carries on from there
+      if (errno == ENOBUFS) return false;
+      Unsubscribe();
+      return false;
+    }
+    int length = count;
+    for (nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer);
+         NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+      if (header->nlmsg_type == NLMSG_ERROR ||
+          header->nlmsg_type == NLMSG_NOOP) {
+        continue;
+      }
+      cn_msg const* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+      if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) {
+        continue;
+      }
+      proc_event const* event =
+          reinterpret_cast<proc_event const*>(message->data);
+      // Threads share the events, only thread group leaders are processes
+      switch (event->what) {
+        case proc_event::PROC_EVENT_FORK:
+          if (event->event_data.fork.child_pid ==
+              event->event_data.fork.child_tgid) {
+            Add(event->event_data.fork.child_tgid);
+          }
+          break;
+        case proc_event::PROC_EVENT_EXEC:
+          execs_.push_back(event->event_data.exec.process_tgid);
+          break;
+        case proc_event::PROC_EVENT_EXIT:
+          if (event->event_data.exit.process_pid ==
+              event->event_data.exit.process_tgid) {
+            Remove(event->event_data.exit.process_tgid);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+// Without events the list is all a tick needs, the index and the birth
+// generations are only there to apply them
+void PidSource::Scan() {
+  LinuxParser::Pids(pids_);
+  if (!Listening()) return;
+  born_.assign(pids_.size(), generation_);
+  index_ = PidIndex();
+  for (size_t i = 0; i < pids_.size(); ++i) index_.Insert(pids_[i], i);
+}
+
+void PidSource::Add(int pid) {
+  if (index_.Find(pid) != PidIndex::kNotFound) return;
+  index_.Insert(pid, pids_.size());
+  pids_.push_back(pid);
+  born_.push_back(generation_);
+}
+
+// The last PID takes the place of the removed one
+void PidSource::Remove(int pid) {
+  uint32_t position = index_.Find(pid);
+  if (position == PidIndex::kNotFound) return;
+  if (born_[position] == generation_) ++short_lived_;
+  index_.Erase(pid);
+  if (position + 1 != pids_.size()) {
+    pids_[position] = pids_.back();
+    born_[position] = born_.back();
+    index_.Insert(pids_[position], position);
+  }
+  pids_.pop_back();
+  born_.pop_back();
+}
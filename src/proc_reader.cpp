@@ -0,0 +1,130 @@
+#include "proc_reader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string_view>
+
+using std::string_view;
+
+namespace {
+// A space separator stands for any whitespace, procfs mixes tabs and spaces
+bool IsSeparator(char c, char separator) {
+  return c == separator || c == '\n' || (separator == ' ' && c == '\t');
+}
+}  // namespace
+
+// Most procfs files fit into a page, bigger ones grow the buffer once
+ProcReader::ProcReader() : buffer_(4096) {}
+
+// procfs reports a size of 0 for its files, so we read until EOF and
+// double the buffer whenever it fills up. The grown buffer is kept for
+// the next file, so in steady state a file costs one read() for its data
+// and one more to see EOF.
+bool ProcReader::Read(const char* path) {
+  size_ = 0;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  while (true) {
+    if (size_ == buffer_.size()) {
+      buffer_.resize(buffer_.size() * 2);
+    }
+    ssize_t count = read(fd, buffer_.data() + size_, buffer_.size() - size_);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      close(fd);
+      size_ = 0;
+      return false;
+    }
+    if (count == 0) break;
+    size_ += count;
+  }
+  close(fd);
+  return true;
+}
+
+// procfs generates the content again for every read from offset 0, so an
+// fd kept open gives the values of the moment like a fresh open would.
+// Reads of a file whose process is gone fail with ESRCH.
+bool ProcReader::Read(int fd) {
+  size_ = 0;
+  while (true) {
+    if (size_ == buffer_.size()) {
+      buffer_.resize(buffer_.size() * 2);
+    }
+    ssize_t count =
+        pread(fd, buffer_.data() + size_, buffer_.size() - size_, size_);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      size_ = 0;
+      return false;
+    }
+    if (count == 0) break;
+    size_ += count;
+  }
+  return true;
+}
+
+string_view ProcReader::Content() const {
+  return string_view(buffer_.data(), size_);
+}
+
+Tokenizer::Tokenizer(string_view text) : rest_(text) {}
+
+// Hands out the next line without its trailing newline
+bool Tokenizer::NextLine(string_view& line) {
+  if (rest_.empty()) return false;
+  size_t end = rest_.find('\n');
+  if (end == string_view::npos) {
+    line = rest_;
+    rest_ = string_view();
+  } else {
+    line = rest_.substr(0, end);
+    rest_.remove_prefix(end + 1);
+  }
+  return true;
+}
+
+// Hands out the next non empty token, skipping leading separators.
+// Newlines always end a token so that single line files parse cleanly.
+bool Tokenizer::NextToken(string_view& token, char separator) {
+  size_t start = 0;
+  while (start < rest_.size() && IsSeparator(rest_[start], separator)) {
+    ++start;
+  }
+  if (start == rest_.size()) {
+    rest_ = string_view();
+    return false;
+  }
+  size_t end = start;
+  while (end < rest_.size() && !IsSeparator(rest_[end], separator)) {
+    ++end;
+  }
+  token = rest_.substr(start, end - start);
+  rest_.remove_prefix(end);
+  return true;
+}
+
+bool Tokenizer::Skip(int count, char separator) {
+  string_view token;
+  for (int i = 0; i < count; ++i) {
+    if (!NextToken(token, separator)) return false;
+  }
+  return true;
+}
+
+string_view Tokenizer::Rest() const { return rest_; }
+
+string_view FindLine(string_view content, string_view key) {
+  Tokenizer lines(content);
+  string_view line;
+  while (lines.NextLine(line)) {
+    if (line.substr(0, key.size()) == key) {
+      return line.substr(key.size());
+    }
+  }
+  return string_view();
+}
@@ -1,82 +1,212 @@
 #include "process.h"
 
-#include <unistd.h>
-
-#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <vector>
 
+#include "format.h"
 #include "linux_parser.h"
+#include "thread_table.h"
 
-using std::map;
 using std::string;
-using std::vector;
 
 Process::Process(int pid)
     : pid_(pid),
-      command_(LinuxParser::Command(pid)),
-      user_(LinuxParser::User(pid)),
-      uid_(LinuxParser::Uid(pid)),
-      upsinceboot_(LinuxParser::UpTime(pid)),
-      procqueuedepth_(10),
-      stale_(false) {}
+      upsinceboot_(0),
+      uptime_(0.0),
+      current_ram_kb_(0) {}
+
+// Read the values that do not change over the life of the process.
+// Kept out of the constructor so that it can run on any worker thread.
+// The user and command of an earlier load are dropped, they are read
+// again when asked for.
+void Process::Load(UserCache& users) {
+  users_ = &users;
+  command_read_ = false;
+  user_read_ = false;
+  cgroup_ = LinuxParser::Cgroup(pid_);
+  restarted_ = false;
+}
 
 // DONE: Return this process's ID
 int Process::Pid() { return pid_; }
 
 // DONE: Return this process's CPU utilization
-float Process::CpuUtilization() { return current_cpu_; }
+float Process::CpuUtilization() { return history_.Utilization(); }
+
+bool Process::Warming() { return history_.Samples() < 2; }
 
 // DONE: Return the command that generated this process
-string Process::Command() { return command_; }
+string const& Process::Command() {
+  if (!command_read_) {
+    command_ = LinuxParser::Command(pid_);
+    command_read_ = true;
+  }
+  return command_;
+}
+
+string const& Process::Cgroup() { return cgroup_; }
+
+void Process::SetCgroupId(uint32_t id) { cgroup_id_ = id; }
+
+uint32_t Process::CgroupId() { return cgroup_id_; }
+
+void Process::Expand(bool expanded) {
+  if (!expanded) {
+    threads_.reset();
+  } else if (!threads_) {
+    threads_ = std::make_unique<ThreadTable>(pid_);
+  }
+}
+
+ThreadTable* Process::Threads() { return threads_.get(); }
+
+// DONE: Return this process's resident memory in MB
+string Process::Ram() { return Format::Megabytes(current_ram_kb_); }
+
+// DONE: Return this process's resident memory in kB
+long Process::RamKb() { return current_ram_kb_; }
+
+// Reads PSS and USS at most once per tick. They stay unknown (-1) where
+// smaps_rollup cannot be read, e.g. for processes of other users.
+void Process::UpdateMemoryDetail(unsigned long tick) {
+  if (detail_tick_ == tick) return;
+  detail_tick_ = tick;
+  LinuxParser::MemoryDetail detail;
+  if (LinuxParser::ReadMemoryDetail(pid_, detail)) {
+    pss_kb_ = detail.pss_kb;
+    uss_kb_ = detail.uss_kb;
+  } else {
+    pss_kb_ = uss_kb_ = -1;
+  }
+}
 
-// DONE: Return this process's memory utilization
-string Process::Ram() { return current_ram_; }
+long Process::PssKb() { return pss_kb_; }
+
+long Process::UssKb() { return uss_kb_; }
 
 // DONE: Return the user (name) that generated this process
-string Process::User() { return user_; }
+string const& Process::User() {
+  if (!user_read_) {
+    int const uid = LinuxParser::Uid(pid_);
+    user_.clear();
+    if (uid >= 0 && users_ != nullptr) user_ = users_->Name(uid);
+    user_read_ = true;
+  }
+  return user_;
+}
+
+void Process::Resolve() {
+  User();
+  Command();
+}
 
 // DONE: Return the age of this process (in seconds)
-long int Process::UpTime() { return LinuxParser::UpTime() - upsinceboot_; }
+long int Process::UpTime() { return long(uptime_) - upsinceboot_; }
 
 // DONE: Overload the "less than" comparison operator for Process objects
 bool Process::operator<(Process const& a) const {
-  return current_cpu_ > a.current_cpu_;
+  return Before(*this, a, SortKey::kCpu);
 }
 
-// Update the Process CPU and RAM utilization
-void Process::UpdateUtilization() {
-  // Get the current stats from stats file
-  map<string, float> procstats = LinuxParser::CpuUtilization(pid_);
-  // Put the current stats to the back of the queue
-  this->prev_stats_.emplace(procstats);
-  // Get the oldest stats from the front of the queue
-  map<string, float> prevprocstats = this->prev_stats_.front();
-
-  float prevtotal{0.0};
-  float prevproctime{0.0};
-  // Only use prevtotal if queue is longer than 1,
-  // Else we run into devision by 0 in return statement
-  if (prev_stats_.size() > 1) {
-    prevtotal = prevprocstats["total_time"];
-    prevproctime = prevprocstats["proc_time"];
+// The numeric columns are ordered from the largest value down, PID and
+// user from the smallest up
+bool Process::Before(Process const& a, Process const& b, SortKey key) {
+  switch (key) {
+    case SortKey::kCpu:
+      if (a.history_.Utilization() != b.history_.Utilization())
+        return a.history_.Utilization() > b.history_.Utilization();
+      break;
+    case SortKey::kMemory:
+      if (a.current_ram_kb_ != b.current_ram_kb_)
+        return a.current_ram_kb_ > b.current_ram_kb_;
+      break;
+    case SortKey::kUptime:
+      // The oldest processes started first
+      if (a.upsinceboot_ != b.upsinceboot_)
+        return a.upsinceboot_ < b.upsinceboot_;
+      break;
+    case SortKey::kUser: {
+      // Both users have to be resolved, see System::Order
+      int order = a.user_.compare(b.user_);
+      if (order != 0) return order < 0;
+      break;
+    }
+    case SortKey::kPid:
+      break;
   }
+  return a.pid_ < b.pid_;
+}
 
-  // Calculate difference between current and oldest total and idle
-  float totald = procstats["total_time"] - prevtotal;
-  float proctimed = procstats["proc_time"] - prevproctime;
-
-  // Pop front element from the queue if its longer than the max time
-  if (prev_stats_.size() > this->procqueuedepth_) {
-    prev_stats_.pop();
+// Update the Process CPU and RAM utilization from one sample of the process,
+// the system uptime is taken once per tick and passed in by the caller.
+// Returns false if the process could not be read, e.g. as it is gone.
+bool Process::UpdateUtilization(double uptime, CpuHistoryConfig const& config,
+                                FdCache* files, size_t carried) {
+  LinuxParser::ProcessSample sample;
+  if (!LinuxParser::ReadProcessSample(pid_, sample, &files_, files))
+    return false;
+  // A process keeps its start time for life, a different one belongs to
+  // a new process that took over the PID and starts a history of its own
+  if (starttime_ != 0 && sample.starttime != starttime_) {
+    history_ = CpuHistory();
+    restarted_ = true;
   }
-  // Store the CPU usage using difference between current and oldest
-  this->current_cpu_ = (totald / procstats["mhz"]) / proctimed;
-
+  // Calculation taken from
+  // https://stackoverflow.com/questions/16726779/how-do-i-get-the-total-cpu-usage-of-an-application-from-proc-pid-stat/16736599#16736599
+  // with the process time and its age both counted in clock ticks
+  history_.Update(TaskTicks(sample.utime + sample.stime + sample.cutime +
+                                sample.cstime,
+                            sample.starttime, uptime),
+                  config, carried);
+
+  uptime_ = uptime;
+  starttime_ = sample.starttime;
+  upsinceboot_ = sample.starttime / ClockTicks();
   // Store the RAM usage of current process
-  this->current_ram_ = LinuxParser::Ram(pid_);
+  this->current_ram_kb_ = sample.rss_kb;
+  return true;
 }
 
-void Process::MarkStale() { stale_ = true; }
+// Most processes sleep, and a process whose CPU time did not move since
+// its last sample is sampled half as often as before, down to once every
+// max_interval ticks and never less often than the utilization looks
+// back. New processes and ones that used the CPU are sampled every tick.
+// In between, the busy time is carried forward and only the age grows,
+// which is exact for as long as the process stays idle; a process that
+// woke up has its CPU time spread over the ticks it was not sampled in.
+// The RAM shown is the one of the last sample.
+bool Process::Update(unsigned long tick, double uptime,
+                     CpuHistoryConfig const& config, unsigned max_interval,
+                     FdCache* files) {
+  if (tick < next_sample_) {
+    history_.Update(TaskTicks(history_.Latest().busy, starttime_, uptime),
+                    config);
+    uptime_ = uptime;
+    return false;
+  }
+  bool const first = next_sample_ == 0;
+  uint64_t const busy = first ? 0 : history_.Latest().busy;
+  size_t const carried = first ? 0 : tick - LastSample() - 1;
+  if (!UpdateUtilization(uptime, config, files, carried)) return true;
+  unsigned const longest = std::min(max_interval, Horizon(config));
+  if (!first && !restarted_ && history_.Latest().busy == busy) {
+    interval_ = std::min(interval_ * 2, std::max(longest, 1u));
+  } else {
+    interval_ = 1;
+  }
+  next_sample_ = tick + interval_;
+  return true;
+}
 
-bool Process::GetStale(const Process& proc_) { return proc_.stale_; }
\ No newline at end of file
+bool Process::Restarted() { return restarted_; }
+
+unsigned long Process::LastSample() { return next_sample_ - interval_; }
+
+void Process::Watch() {
+  if (next_sample_ == 0) return;
+  unsigned long const last = LastSample();
+  interval_ = 1;
+  next_sample_ = last + 1;
+}
@@ -0,0 +1,130 @@
+#include "process_table.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "process.h"
+
+using std::vector;
+
+namespace {
+// Empty buckets carry a PID that never exists on the system
+constexpr int kEmpty{-1};
+constexpr int kInitialBits{10};
+constexpr size_t kInitialBuckets{size_t(1) << kInitialBits};
+}  // namespace
+
+PidIndex::PidIndex()
+    : entries_(kInitialBuckets, {kEmpty, 0}),
+      mask_(kInitialBuckets - 1),
+      shift_(32 - kInitialBits) {}
+
+// Fibonacci hashing, the top bits of the product pick the bucket
+size_t PidIndex::Bucket(int pid) const {
+  return (uint32_t(pid) * 2654435769u) >> shift_;
+}
+
+uint32_t PidIndex::Find(int pid) const {
+  for (size_t i = Bucket(pid);; i = (i + 1) & mask_) {
+    if (entries_[i].pid == pid) return entries_[i].slot;
+    if (entries_[i].pid == kEmpty) return kNotFound;
+  }
+}
+
+void PidIndex::Insert(int pid, uint32_t slot) {
+  // Keep the load factor below one half to keep the probe sequences short
+  if (2 * (size_ + 1) > entries_.size()) Grow();
+  size_t i = Bucket(pid);
+  while (entries_[i].pid != kEmpty && entries_[i].pid != pid) {
+    i = (i + 1) & mask_;
+  }
+  if (entries_[i].pid == kEmpty) ++size_;
+  entries_[i] = {pid, slot};
+}
+
+void PidIndex::Erase(int pid) {
+  size_t i = Bucket(pid);
+  while (entries_[i].pid != pid) {
+    if (entries_[i].pid == kEmpty) return;
+    i = (i + 1) & mask_;
+  }
+  // Shift back every following entry of the cluster that would no longer
+  // be reachable from its home bucket through the freed bucket
+  size_t hole = i;
+  for (size_t j = (i + 1) & mask_; entries_[j].pid != kEmpty;
+       j = (j + 1) & mask_) {
+    size_t home = Bucket(entries_[j].pid);
+    if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+      entries_[hole] = entries_[j];
+      hole = j;
+    }
+  }
+  entries_[hole].pid = kEmpty;
+  --size_;
+}
+
+void PidIndex::Grow() {
+  vector<Entry> old(entries_.size() * 2, {kEmpty, 0});
+  old.swap(entries_);
+  mask_ = entries_.size() - 1;
+  --shift_;
+  size_ = 0;
+  for (Entry const& entry : old) {
+    if (entry.pid != kEmpty) Insert(entry.pid, entry.slot);
+  }
+}
+
+// One pass over the PIDs of this tick marks the slots that are still alive
+// and creates the new ones, one pass over the slots releases the rest
+void ProcessTable::Reconcile(vector<int> const& pids) {
+  ++generation_;
+  added_.clear();
+  removed_.clear();
+  for (int pid : pids) {
+    uint32_t slot = index_.Find(pid);
+    if (slot == PidIndex::kNotFound) {
+      slot = Allocate();
+      added_.push_back(&slots_[slot].emplace(pid));
+      index_.Insert(pid, slot);
+    }
+    seen_[slot] = generation_;
+  }
+
+  live_.clear();
+  for (uint32_t slot = 0; slot < slots_.size(); ++slot) {
+    std::optional<Process>& process = slots_[slot];
+    if (!process) continue;
+    if (seen_[slot] == generation_) {
+      live_.push_back(&*process);
+    } else {
+      index_.Erase(process->Pid());
+      removed_.push_back(process->Pid());
+      process.reset();
+      free_.push_back(slot);
+    }
+  }
+}
+
+Process* ProcessTable::Find(int pid) {
+  uint32_t slot = index_.Find(pid);
+  if (slot == PidIndex::kNotFound) return nullptr;
+  return &*slots_[slot];
+}
+
+vector<Process*>& ProcessTable::Processes() { return live_; }
+
+vector<Process*>& ProcessTable::Added() { return added_; }
+
+vector<int>& ProcessTable::Removed() { return removed_; }
+
+// Reuses a released slot or appends one, which keeps existing slots in place
+uint32_t ProcessTable::Allocate() {
+  if (!free_.empty()) {
+    uint32_t slot = free_.back();
+    free_.pop_back();
+    return slot;
+  }
+  slots_.emplace_back();
+  seen_.push_back(0);
+  return slots_.size() - 1;
+}
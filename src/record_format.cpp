@@ -0,0 +1,88 @@
+#include "record_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+
+void RecordFormat::PutVarint(string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out += char(value | 0x80);
+    value >>= 7;
+  }
+  out += char(value);
+}
+
+// Zigzag maps small negative and positive deltas to small varints
+void RecordFormat::PutSigned(string& out, int64_t value) {
+  PutVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+void RecordFormat::PutString(string& out, string_view text) {
+  PutVarint(out, text.size());
+  out.append(text);
+}
+
+RecordFormat::Reader::Reader(char const* begin, char const* end)
+    : position_(begin), end_(end) {}
+
+bool RecordFormat::Reader::Varint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; !failed_ && shift < 64; shift += 7) {
+    if (position_ == end_) break;
+    uint8_t byte = *position_++;
+    value |= uint64_t(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  failed_ = true;
+  return false;
+}
+
+bool RecordFormat::Reader::Signed(int64_t& value) {
+  uint64_t encoded;
+  if (!Varint(encoded)) return false;
+  value = int64_t(encoded >> 1) ^ -int64_t(encoded & 1);
+  return true;
+}
+
+bool RecordFormat::Reader::Byte(uint8_t& value) {
+  if (failed_ || position_ == end_) {
+    failed_ = true;
+    return false;
+  }
+  value = *position_++;
+  return true;
+}
+
+bool RecordFormat::Reader::String(string_view& text) {
+  uint64_t size;
+  if (!Varint(size)) return false;
+  if (size > uint64_t(end_ - position_)) {
+    failed_ = true;
+    return false;
+  }
+  text = string_view(position_, size);
+  position_ += size;
+  return true;
+}
+
+bool RecordFormat::Reader::Failed() const { return failed_; }
+
+size_t RecordFormat::Reader::Remaining() const { return end_ - position_; }
+
+char const* RecordFormat::Reader::Position() const { return position_; }
+
+bool RecordFormat::FrameAt(char const* data, size_t size, size_t offset,
+                           uint8_t& type, Reader& payload, size_t& next) {
+  Reader header(data + offset, data + size);
+  uint64_t length;
+  if (!header.Varint(length) || !header.Byte(type)) return false;
+  char const* begin = header.Position();
+  if (length > uint64_t(data + size - begin)) return false;
+  payload = Reader(begin, begin + length);
+  next = begin + length - data;
+  return true;
+}
@@ -0,0 +1,230 @@
+#include "record_session.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "process.h"
+#include "record_format.h"
+#include "snapshot.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+using namespace RecordFormat;
+
+bool RecordSession::Apply(uint8_t type, Reader payload) {
+  if (type == kTick) return ApplyTick(payload);
+  if (type == kHost) {
+    string_view os, kernel, host;
+    if (!payload.String(os) || !payload.String(kernel)) return false;
+    if (payload.Remaining() > 0 && !payload.String(host)) return false;
+    os_ = string(os);
+    kernel_ = string(kernel);
+    host_ = string(host);
+  } else if (type == kString) {
+    strings_.emplace_back(payload.Position(),
+                          payload.Position() + payload.Remaining());
+  }
+  return true;
+}
+
+// A frame is applied as far as it could be read, a malformed one ends the
+// stream anyway
+bool RecordSession::ApplyTick(Reader& payload) {
+  int64_t time_delta{0}, total_delta{0}, uptime_delta{0};
+  uint64_t cpu{0}, memory{0}, running{0}, short_lived{0}, removed{0};
+  payload.Signed(time_delta);
+  payload.Varint(cpu);
+  payload.Varint(memory);
+  payload.Signed(total_delta);
+  payload.Varint(running);
+  payload.Varint(short_lived);
+  payload.Signed(uptime_delta);
+  payload.Varint(removed);
+  int pid{0};
+  for (uint64_t i = 0; i < removed && !payload.Failed(); ++i) {
+    uint64_t delta{0};
+    payload.Varint(delta);
+    pid += delta;
+    processes_.erase(pid);
+  }
+  uint64_t changed{0};
+  payload.Varint(changed);
+  pid = 0;
+  for (uint64_t i = 0; i < changed && !payload.Failed(); ++i) {
+    uint64_t delta{0}, value;
+    int64_t difference;
+    uint8_t mask{0};
+    payload.Varint(delta);
+    payload.Byte(mask);
+    pid += delta;
+    Entry& entry = processes_[pid];
+    entry.pid = pid;
+    if ((mask & kCpu) && payload.Varint(value)) entry.cpu = value;
+    if ((mask & kRam) && payload.Signed(difference)) {
+      entry.ram_kb += difference;
+    }
+    if ((mask & kStart) && payload.Signed(difference)) {
+      entry.start += difference;
+    }
+    if ((mask & kUser) && payload.Varint(value)) entry.user = value;
+    if ((mask & kCommand) && payload.Varint(value)) entry.command = value;
+    if (entry.user >= strings_.size() || entry.command >= strings_.size()) {
+      return false;
+    }
+  }
+  if (payload.Failed()) return false;
+  time_ms_ += time_delta;
+  cpu_ = cpu / kUnit;
+  memory_ = memory / kUnit;
+  total_processes_ += total_delta;
+  running_processes_ = running;
+  short_lived_ = int(short_lived) - 1;
+  uptime_ += uptime_delta;
+  ++ticks_;
+  return true;
+}
+
+string const& RecordSession::Os() const { return os_; }
+
+string const& RecordSession::Kernel() const { return kernel_; }
+
+string const& RecordSession::Host() const { return host_; }
+
+void RecordSession::Rename(string const& host) { host_ = host; }
+
+string const& RecordSession::String(uint32_t id) const {
+  return strings_[id];
+}
+
+std::unordered_map<int, RecordSession::Entry> const&
+RecordSession::Processes() const {
+  return processes_;
+}
+
+long RecordSession::TimeMs() const { return time_ms_; }
+
+unsigned long RecordSession::Ticks() const { return ticks_; }
+
+float RecordSession::Cpu() const { return cpu_; }
+
+float RecordSession::Memory() const { return memory_; }
+
+long RecordSession::TotalProcesses() const { return total_processes_; }
+
+int RecordSession::RunningProcesses() const { return running_processes_; }
+
+int RecordSession::ShortLived() const { return short_lived_; }
+
+long RecordSession::UpTime() const { return uptime_; }
+
+// DONE: Only the processes up to the last row are ordered, across all
+// sessions. Equal values are ordered by PID and then by host, so the rows
+// of several hosts do not swap places between ticks.
+void SessionMerger::Fill(vector<RecordSession const*> const& sessions,
+                         SortKey key, size_t rows, size_t first, bool hosts,
+                         Snapshot& snapshot) {
+  order_.clear();
+  for (RecordSession const* session : sessions) {
+    for (auto const& process : session->Processes()) {
+      order_.push_back({session, &process.second});
+    }
+  }
+  auto before = [key](Ref const& a, Ref const& b) {
+    switch (key) {
+      case SortKey::kCpu:
+        if (a.entry->cpu != b.entry->cpu) return a.entry->cpu > b.entry->cpu;
+        break;
+      case SortKey::kMemory:
+        if (a.entry->ram_kb != b.entry->ram_kb) {
+          return a.entry->ram_kb > b.entry->ram_kb;
+        }
+        break;
+      case SortKey::kUptime: {
+        // Sessions have their own boot time, the age is what compares
+        long const age_a = a.session->UpTime() - a.entry->start;
+        long const age_b = b.session->UpTime() - b.entry->start;
+        if (age_a != age_b) return age_a > age_b;
+        break;
+      }
+      case SortKey::kUser: {
+        int order = a.session->String(a.entry->user)
+                        .compare(b.session->String(b.entry->user));
+        if (order != 0) return order < 0;
+        break;
+      }
+      case SortKey::kPid:
+        break;
+    }
+    if (a.entry->pid != b.entry->pid) return a.entry->pid < b.entry->pid;
+    return a.session->Host() < b.session->Host();
+  };
+  first = std::min(first, order_.size());
+  size_t const end = std::min(first + rows, order_.size());
+  std::partial_sort(order_.begin(), order_.begin() + end, order_.end(),
+                    before);
+
+  snapshot.os.clear();
+  snapshot.kernel.clear();
+  snapshot.cpu = 0;
+  snapshot.memory = 0;
+  snapshot.total_processes = 0;
+  snapshot.running_processes = 0;
+  snapshot.short_lived = 0;
+  snapshot.uptime = 0;
+  snapshot.samples = 0;
+  for (RecordSession const* session : sessions) {
+    snapshot.samples += session->Ticks();
+    snapshot.cpu += session->Cpu() / sessions.size();
+    snapshot.memory += session->Memory() / sessions.size();
+    snapshot.total_processes += session->TotalProcesses();
+    snapshot.running_processes += session->RunningProcesses();
+    if (snapshot.short_lived >= 0 && session->ShortLived() >= 0) {
+      snapshot.short_lived += session->ShortLived();
+    } else {
+      snapshot.short_lived = -1;
+    }
+    snapshot.uptime = std::max(snapshot.uptime, session->UpTime());
+  }
+  if (sessions.size() == 1) {
+    snapshot.os = sessions[0]->Os();
+    snapshot.kernel = sessions[0]->Kernel();
+  } else {
+    snapshot.os = std::to_string(sessions.size()) + " hosts";
+    for (RecordSession const* session : sessions) {
+      if (snapshot.kernel.empty()) {
+        snapshot.kernel = session->Kernel();
+      } else if (snapshot.kernel != session->Kernel()) {
+        snapshot.kernel = "mixed";
+        break;
+      }
+    }
+  }
+  snapshot.key = key;
+  snapshot.first = first;
+  snapshot.process_count = order_.size();
+  snapshot.hosts = hosts;
+  snapshot.rows.resize(end - first);
+  for (size_t i = 0; i < end - first; ++i) {
+    RecordSession const& session = *order_[first + i].session;
+    RecordSession::Entry const& entry = *order_[first + i].entry;
+    ProcessRow& row = snapshot.rows[i];
+    row.pid = entry.pid;
+    row.cpu = entry.cpu / kUnit;
+    row.warming = false;
+    row.ram_kb = entry.ram_kb;
+    row.uptime = session.UpTime() - entry.start;
+    row.user = session.String(entry.user);
+    row.command = session.String(entry.command);
+    if (hosts) {
+      row.host = session.Host();
+    } else {
+      row.host.clear();
+    }
+  }
+}
@@ -0,0 +1,178 @@
+#include "recorder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "output_buffer.h"
+#include "process.h"
+#include "record_format.h"
+#include "system.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+using namespace RecordFormat;
+
+namespace {
+uint32_t FixedPoint(float value) {
+  return value > 0 ? uint32_t(std::lround(value * kUnit)) : 0;
+}
+}  // namespace
+
+Recorder::~Recorder() {
+  out_.reset();
+  if (fd_ >= 0) close(fd_);
+}
+
+bool Recorder::Open(string const& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  Attach(fd);
+  return true;
+}
+
+void Recorder::Attach(int fd) {
+  out_.reset();
+  if (fd_ >= 0) close(fd_);
+  fd_ = fd;
+  failed_ = false;
+  ids_.clear();
+  strings_.clear();
+  processes_.clear();
+  generation_ = 0;
+  time_ms_ = 0;
+  total_processes_ = 0;
+  uptime_ = 0;
+  out_.emplace(fd_);
+  out_->Append(kMagic);
+}
+
+bool Recorder::Failed() const { return failed_; }
+
+// Strings are written the first time they are used, the id is their
+// position in the file
+uint32_t Recorder::Intern(string const& text) {
+  auto [entry, added] = ids_.try_emplace(text, strings_.size());
+  if (added) {
+    strings_.push_back(&entry->first);
+    Frame(kString, text);
+  }
+  return entry->second;
+}
+
+void Recorder::Frame(uint8_t type, string_view payload) {
+  PutVarint(frame_, payload.size());
+  frame_ += char(type);
+  frame_.append(payload);
+}
+
+// DONE: Compare every process with the values written for its PID and
+// encode the ones that differ. The frames of a tick are built in memory
+// and handed to the file in one piece.
+bool Recorder::Write(System& system, vector<Process*>& processes) {
+  if (!out_ || failed_) return false;
+  frame_.clear();
+  if (generation_ == 0) {
+    payload_.clear();
+    PutString(payload_, system.OperatingSystem());
+    PutString(payload_, system.Kernel());
+    char host[256]{};
+    gethostname(host, sizeof(host) - 1);
+    PutString(payload_, host);
+    Frame(kHost, payload_);
+  }
+  ++generation_;
+
+  long const uptime = system.UpTime();
+  changes_.clear();
+  for (Process* process : processes) {
+    auto [position, added] = processes_.try_emplace(process->Pid());
+    Entry& entry = position->second;
+    Change change{process->Pid(), uint8_t(added ? kAllFields : 0), 0, 0, 0,
+                  0, 0};
+    uint32_t const cpu = FixedPoint(process->CpuUtilization());
+    if (cpu != entry.cpu) change.mask |= kCpu;
+    change.cpu = entry.cpu = cpu;
+    long const ram_kb = process->RamKb();
+    if (ram_kb != entry.ram_kb) change.mask |= kRam;
+    change.ram_kb = ram_kb - entry.ram_kb;
+    entry.ram_kb = ram_kb;
+    long const start = uptime - process->UpTime();
+    if (start != entry.start) change.mask |= kStart;
+    change.start = start - entry.start;
+    entry.start = start;
+    if (added || *strings_[entry.user] != process->User()) {
+      change.mask |= kUser;
+      entry.user = Intern(process->User());
+    }
+    change.user = entry.user;
+    if (added || *strings_[entry.command] != process->Command()) {
+      change.mask |= kCommand;
+      entry.command = Intern(process->Command());
+    }
+    change.command = entry.command;
+    entry.generation = generation_;
+    if (change.mask != 0) changes_.push_back(change);
+  }
+  removed_.clear();
+  for (auto entry = processes_.begin(); entry != processes_.end();) {
+    if (entry->second.generation != generation_) {
+      removed_.push_back(entry->first);
+      entry = processes_.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
+  std::sort(removed_.begin(), removed_.end());
+  std::sort(changes_.begin(), changes_.end(),
+            [](Change const& a, Change const& b) { return a.pid < b.pid; });
+
+  long const time_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  long const total_processes = system.TotalProcesses();
+  payload_.clear();
+  PutSigned(payload_, time_ms - time_ms_);
+  PutVarint(payload_, FixedPoint(system.Cpu().Utilization()));
+  PutVarint(payload_, FixedPoint(system.MemoryUtilization()));
+  PutSigned(payload_, total_processes - total_processes_);
+  PutVarint(payload_, std::max(0, system.RunningProcesses()));
+  PutVarint(payload_, system.ShortLivedProcesses() + 1);
+  PutSigned(payload_, uptime - uptime_);
+  time_ms_ = time_ms;
+  total_processes_ = total_processes;
+  uptime_ = uptime;
+
+  PutVarint(payload_, removed_.size());
+  int pid{0};
+  for (int removed : removed_) {
+    PutVarint(payload_, removed - pid);
+    pid = removed;
+  }
+  PutVarint(payload_, changes_.size());
+  pid = 0;
+  for (Change const& change : changes_) {
+    PutVarint(payload_, change.pid - pid);
+    pid = change.pid;
+    payload_ += char(change.mask);
+    if (change.mask & kCpu) PutVarint(payload_, change.cpu);
+    if (change.mask & kRam) PutSigned(payload_, change.ram_kb);
+    if (change.mask & kStart) PutSigned(payload_, change.start);
+    if (change.mask & kUser) PutVarint(payload_, change.user);
+    if (change.mask & kCommand) PutVarint(payload_, change.command);
+  }
+  Frame(kTick, payload_);
+
+  out_->Append(frame_);
+  failed_ = !out_->Flush();
+  return !failed_;
+}
@@ -0,0 +1,112 @@
+#include "replayer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "process.h"
+#include "record_format.h"
+#include "record_session.h"
+#include "snapshot.h"
+
+using std::string;
+using std::string_view;
+using namespace RecordFormat;
+
+Replayer::Replayer(double speed) : speed_(speed) {}
+
+Replayer::~Replayer() {
+  if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+}
+
+bool Replayer::Open(string const& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat status;
+  if (fstat(fd, &status) < 0 || size_t(status.st_size) < kMagic.size()) {
+    close(fd);
+    return false;
+  }
+  void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  data_ = static_cast<char const*>(data);
+  size_ = status.st_size;
+  if (string_view(data_, kMagic.size()) != kMagic) return false;
+  offset_ = kMagic.size();
+  started_ = std::chrono::steady_clock::now();
+  NextTime(first_time_ms_);
+  return true;
+}
+
+void Replayer::Request(SortKey key, std::size_t rows, std::size_t first) {
+  if (key == key_ && rows == rows_ && first == first_) return;
+  key_ = key;
+  rows_ = rows;
+  first_ = first;
+  changed_ = true;
+}
+
+// Applies every tick the replay clock has reached, the first one right
+// away. The snapshot is only rebuilt if a tick or the request changed.
+Snapshot const& Replayer::Latest(bool* fresh) {
+  using std::chrono::duration;
+  double const elapsed_ms =
+      duration<double, std::milli>(std::chrono::steady_clock::now() - started_)
+          .count();
+  long const due_ms = first_time_ms_ + long(elapsed_ms * speed_);
+  bool advanced{false};
+  long time_ms;
+  while (NextTime(time_ms) && (session_.Ticks() == 0 || time_ms <= due_ms)) {
+    if (!ApplyTick()) break;
+    advanced = true;
+  }
+  bool const updated = advanced || changed_;
+  if (updated) {
+    merger_.Fill({&session_}, key_, rows_, first_, false, snapshot_);
+    snapshot_.tick = session_.Ticks();
+  }
+  changed_ = false;
+  if (fresh != nullptr) *fresh = updated;
+  return snapshot_;
+}
+
+// Applies the frames up to the next tick and peeks at its time. The tick
+// frame itself stays in place for ApplyTick.
+bool Replayer::NextTime(long& time_ms) {
+  while (!ended_) {
+    uint8_t type;
+    Reader payload(nullptr, nullptr);
+    size_t next;
+    if (!FrameAt(data_, size_, offset_, type, payload, next)) break;
+    if (type == kTick) {
+      int64_t delta;
+      if (!payload.Signed(delta)) break;
+      time_ms = session_.TimeMs() + delta;
+      return true;
+    }
+    if (!session_.Apply(type, payload)) break;
+    offset_ = next;
+  }
+  ended_ = true;
+  return false;
+}
+
+bool Replayer::ApplyTick() {
+  uint8_t type;
+  Reader payload(nullptr, nullptr);
+  size_t next;
+  FrameAt(data_, size_, offset_, type, payload, next);
+  if (!session_.Apply(type, payload)) {
+    ended_ = true;
+    return false;
+  }
+  offset_ = next;
+  return true;
+}
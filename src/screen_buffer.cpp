@@ -0,0 +1,72 @@
+#include "screen_buffer.h"
+
+#include <curses.h>
+
+#include <algorithm>
+#include <string_view>
+
+using std::string_view;
+
+namespace {
+// Only printable ASCII fits into one cell, anything else is shown as '?'
+chtype Cell(char c, attr_t attr) {
+  unsigned char byte = c;
+  if (byte < 0x20 || byte >= 0x7f) byte = '?';
+  return chtype(byte) | attr;
+}
+}  // namespace
+
+void ScreenBuffer::Resize(int rows, int cols) {
+  rows_ = std::max(0, rows - 2);
+  cols_ = std::max(0, cols - 2);
+  current_.assign(rows_ * cols_, ' ');
+  previous_.assign(rows_ * cols_, ' ');
+  redraw_ = true;
+}
+
+void ScreenBuffer::Clear() { std::fill(current_.begin(), current_.end(), ' '); }
+
+void ScreenBuffer::Put(int row, int col, string_view text, attr_t attr) {
+  // Row and column 0 of the window are its border
+  if (row < 1 || row > rows_) return;
+  chtype* line = current_.data() + (row - 1) * cols_;
+  for (char c : text) {
+    if (col > cols_) break;
+    if (col >= 1) line[col - 1] = Cell(c, attr);
+    ++col;
+  }
+}
+
+void ScreenBuffer::Put(int row, int col, char c, attr_t attr) {
+  Put(row, col, string_view(&c, 1), attr);
+}
+
+void ScreenBuffer::Highlight(int row, attr_t attr) {
+  if (row < 1 || row > rows_) return;
+  chtype* line = current_.data() + (row - 1) * cols_;
+  for (int col = 0; col < cols_; ++col) line[col] |= attr;
+}
+
+// Every run of changed cells on a row goes out in one call
+int ScreenBuffer::Flush(WINDOW* window) {
+  int changed{0};
+  for (int row = 0; row < rows_; ++row) {
+    chtype const* now = current_.data() + row * cols_;
+    chtype const* before = previous_.data() + row * cols_;
+    int col = 0;
+    while (col < cols_) {
+      if (!redraw_ && now[col] == before[col]) {
+        ++col;
+        continue;
+      }
+      int end = col + 1;
+      while (end < cols_ && (redraw_ || now[end] != before[end])) ++end;
+      mvwaddchnstr(window, row + 1, col + 1, now + col, end - col);
+      changed += end - col;
+      col = end;
+    }
+  }
+  redraw_ = false;
+  previous_.swap(current_);
+  return changed;
+}
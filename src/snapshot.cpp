@@ -0,0 +1,21 @@
+#include "snapshot.h"
+
+#include <atomic>
+#include <cstdint>
+
+Snapshot& SnapshotExchange::Back() { return buffers_[back_]; }
+
+void SnapshotExchange::Publish() {
+  std::uint8_t old = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+  back_ = old & kIndex;
+}
+
+Snapshot const& SnapshotExchange::Latest(bool* fresh) {
+  bool const updated = middle_.load(std::memory_order_relaxed) & kFresh;
+  if (updated) {
+    std::uint8_t old = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = old & kIndex;
+  }
+  if (fresh != nullptr) *fresh = updated;
+  return buffers_[front_];
+}
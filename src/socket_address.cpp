@@ -0,0 +1,123 @@
+#include "socket_address.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+using std::string;
+
+namespace {
+sockaddr_un UnixAddress(SocketAddress const& address) {
+  sockaddr_un local{};
+  local.sun_family = AF_UNIX;
+  strncpy(local.sun_path, address.path.c_str(), sizeof(local.sun_path) - 1);
+  return local;
+}
+
+// Tries every address the host resolves to until one takes the socket
+template <typename Use>
+int Resolve(SocketAddress const& address, int flags, int type_flags,
+            Use use) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = flags;
+  addrinfo* found{nullptr};
+  if (getaddrinfo(address.host.c_str(), address.port.c_str(), &hints,
+                  &found) != 0) {
+    errno = EADDRNOTAVAIL;
+    return -1;
+  }
+  int fd{-1};
+  for (addrinfo* info = found; info != nullptr; info = info->ai_next) {
+    fd = socket(info->ai_family, info->ai_socktype | type_flags, 0);
+    if (fd < 0) continue;
+    if (use(fd, info->ai_addr, info->ai_addrlen)) break;
+    int const error = errno;
+    close(fd);
+    errno = error;
+    fd = -1;
+  }
+  freeaddrinfo(found);
+  return fd;
+}
+}  // namespace
+
+bool Socket::ParseAddress(string const& text, SocketAddress& address) {
+  address = SocketAddress();
+  if (text.rfind("unix:", 0) == 0) {
+    address.unix_socket = true;
+    address.path = text.substr(5);
+    return !address.path.empty() &&
+           address.path.size() < sizeof(sockaddr_un::sun_path);
+  }
+  size_t const colon = text.rfind(':');
+  if (colon == string::npos || colon + 1 == text.size()) return false;
+  address.host = colon == 0 ? "127.0.0.1" : text.substr(0, colon);
+  address.port = text.substr(colon + 1);
+  return true;
+}
+
+int Socket::Listen(SocketAddress const& address) {
+  int fd{-1};
+  if (address.unix_socket) {
+    sockaddr_un local = UnixAddress(address);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    // A socket left behind by an earlier run would fail the bind, any
+    // other file in its place is kept and fails it
+    struct stat status;
+    if (lstat(address.path.c_str(), &status) == 0) {
+      if (!S_ISSOCK(status.st_mode)) {
+        close(fd);
+        errno = EADDRINUSE;
+        return -1;
+      }
+      unlink(address.path.c_str());
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+      close(fd);
+      return -1;
+    }
+  } else {
+    fd = Resolve(address, AI_PASSIVE, SOCK_NONBLOCK | SOCK_CLOEXEC,
+                 [](int fd, sockaddr const* local, socklen_t size) {
+                   int const reuse{1};
+                   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                              sizeof(reuse));
+                   return bind(fd, local, size) == 0;
+                 });
+    if (fd < 0) return -1;
+  }
+  if (listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Connecting blocks, which on a local network is a matter of a round trip
+int Socket::Connect(SocketAddress const& address) {
+  if (!address.unix_socket) {
+    return Resolve(address, 0, SOCK_CLOEXEC,
+                   [](int fd, sockaddr const* remote, socklen_t size) {
+                     return connect(fd, remote, size) == 0;
+                   });
+  }
+  sockaddr_un remote = UnixAddress(address);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) != 0) {
+    int const error = errno;
+    close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
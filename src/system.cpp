@@ -2,85 +2,290 @@
 
 #include <unistd.h>
 
-#include <set>
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include "cgroup_table.h"
+#include "fd_cache.h"
+#include "filter_index.h"
 #include "linux_parser.h"
+#include "overhead.h"
+#include "pid_source.h"
 #include "process.h"
+#include "process_table.h"
 #include "processor.h"
+#include "thread_table.h"
+#include "worker_pool.h"
 
-using std::find;
-using std::inserter;
-using std::set;
-using std::set_difference;
 using std::sort;
 using std::string;
 using std::vector;
 
-System::System()
-    : kernel_(LinuxParser::Kernel()), osname_(LinuxParser::OperatingSystem()) {}
+// Processes are sampled on options.threads workers, 0 is one per core.
+// The aggregate CPU keeps its short window but follows the averaging mode.
+System::System(Options const& options)
+    : cpu_({options.history.mode, 3, options.history.alpha}),
+      pids_(options.proc_events),
+      pool_(options.threads),
+      history_(options.history),
+      idle_interval_(options.idle_interval),
+      kernel_(LinuxParser::Kernel()),
+      osname_(LinuxParser::OperatingSystem()) {
+  ProcessFilter::Parse(options.filter, filter_);
+}
+
+// DONE: Take the system wide values of this tick from one read of procfs,
+// all accessors below serve them until the next refresh
+void System::Refresh() {
+  LinuxParser::ReadSystemSnapshot(snapshot_, &system_files_);
+  cpu_.Update(snapshot_.cpu);
+  users_.Revalidate();
+}
 
 // DONE: Return the system's CPU
 Processor& System::Cpu() { return cpu_; }
 
 // DONE: Return a container composed of the system's processes
-vector<Process>& System::Processes() {
-  vector<int> currentpids = LinuxParser::Pids();
-  vector<int> cachedpids;
-
-  // Loop to check if Pids on system are in the processes_ vector.
-  // If in vector, update stats. If object is stale, mark it as such.
-  for (auto& procobj : processes_) {
-    int currentpid = procobj.Pid();
-    vector<int>::iterator it =
-        find(currentpids.begin(), currentpids.end(), currentpid);
-    if (it != currentpids.end()) {
-      procobj.UpdateUtilization();
-      cachedpids.emplace_back(currentpid);
-    } else {
-      // Mark object as stale in processes_
-      procobj.MarkStale();
+vector<Process*>& System::Processes(SortKey key, size_t n, size_t first) {
+  PhaseTimer timer;
+  vector<int> const& pids = pids_.Pids();
+  phases_.scan_us = timer.Lap();
+  ++tick_;
+  sampled_ = 0;
+  warming_.clear();
+  warmed_ = 0;
+  Sample(pids, true);
+  FinishTick();
+  phases_.sample_us = timer.Lap();
+
+  Select();
+  return Order(key, n, first);
+}
+
+// The PIDs are taken once, each call samples a longer prefix of them as
+// the first tick, so a huge table shows its first rows after one batch
+// instead of after every process was read
+bool System::Warm(size_t batch) {
+  PhaseTimer timer;
+  if (tick_ == 0) {
+    warming_ = pids_.Pids();
+    warmed_ = 0;
+    phases_.scan_us = timer.Lap();
+    phases_.sample_us = 0;
+    ++tick_;
+    sampled_ = 0;
+  }
+  if (warmed_ == warming_.size()) return true;
+  warmed_ = std::min(warmed_ + std::max<size_t>(batch, 1), warming_.size());
+  vector<int> const pids(warming_.begin(), warming_.begin() + warmed_);
+  Sample(pids, false);
+  bool const done = warmed_ == warming_.size();
+  if (done) {
+    FinishTick();
+    warming_.clear();
+    warmed_ = 0;
+  }
+  phases_.sample_us += timer.Lap();
+  Select();
+  return done;
+}
+
+// Brings the process table in line with the PIDs and samples the
+// processes of this tick. Without all, only the processes new to the
+// table are sampled, the others were sampled earlier in the same tick.
+void System::Sample(vector<int> const& pids, bool all) {
+  // This creates the new processes and drops the ones that are gone
+  processes_.Reconcile(pids);
+
+  // Sample the processes on all workers, every worker thread parses
+  // through its own read buffer. Users and commands wait until they are
+  // shown, unless the filter index needs them right away.
+  vector<Process*>& added = processes_.Added();
+  bool const resolve = index_.IndexesText();
+  pool_.ParallelFor(added.size(), [&](size_t i) {
+    added[i]->Load(users_);
+    if (resolve) added[i]->Resolve();
+  });
+  // A process that ran exec keeps its PID but has a new command. In the
+  // first tick every process is loaded after the scan, execs included.
+  if (all) {
+    for (int pid : pids_.Execs()) {
+      Process* process = processes_.Find(pid);
+      if (process != nullptr) Reload(*process);
     }
   }
+  // The cgroup of a process is only read when it is loaded, moving it to
+  // another cgroup later is rare enough to be left unseen until an exec
+  for (Process* process : added) {
+    process->SetCgroupId(cgroups_.Intern(process->Cgroup()));
+  }
+  // The filter index only changes with the processes that came and went,
+  // those that were loaded again update it in Reload
+  for (int pid : processes_.Removed()) index_.Remove(pid);
+  for (Process* process : added) index_.Add(*process);
+  // Idle processes are only read every few ticks, see Process::Update.
+  // Every worker counts its samples on its own cache line.
+  struct alignas(64) Count {
+    size_t value{0};
+  };
+  vector<Count> sampled(pool_.Workers());
+  vector<Process*>& updated = all ? processes_.Processes() : added;
+  double const uptime = snapshot_.uptime;
+  unsigned long const tick = tick_;
+  pool_.ParallelFor(updated.size(), [&](size_t i, unsigned worker) {
+    if (updated[i]->Update(tick, uptime, history_, idle_interval_, &files_)) {
+      ++sampled[worker].value;
+    }
+  });
+  for (Count const& count : sampled) sampled_ += count.value;
+  // A PID taken by a new process between two samples shows up as a new
+  // start time, the process is loaded again like after an exec
+  for (Process* process : updated) {
+    if (process->Restarted()) Reload(*process);
+  }
+}
+
+// Threads and cgroups are sampled once per tick, after all processes
+void System::FinishTick() {
+  // Expanded processes that are gone take their threads with them
+  auto gone = [this](int pid) { return processes_.Find(pid) == nullptr; };
+  expanded_.erase(std::remove_if(expanded_.begin(), expanded_.end(), gone),
+                  expanded_.end());
+  for (int pid : expanded_) SampleThreads(*processes_.Find(pid));
+
+  // Every populated cgroup is read once, whatever number of processes
+  // it holds
+  cgroups_.Count(processes_.Processes());
+  double const uptime = snapshot_.uptime;
+  pool_.ParallelFor(cgroups_.Size(), [&](size_t i) {
+    cgroups_.Sample(i, uptime, history_);
+  });
+}
+
+void System::Filter(ProcessFilter const& filter) {
+  filter_ = filter;
+  Select();
+}
+
+vector<Process*>& System::AllProcesses() { return processes_.Processes(); }
+
+void System::Resolve(vector<Process*>& processes) {
+  pool_.ParallelFor(processes.size(),
+                    [&](size_t i) { processes[i]->Resolve(); });
+}
+
+// The processes to order are looked up in the index, not matched one by
+// one
+void System::Select() {
+  vector<Process*>& live = processes_.Processes();
+  if (filter_.Empty()) {
+    sorted_.assign(live.begin(), live.end());
+  } else {
+    if (filter_.NeedsText() && !index_.IndexesText()) Resolve(live);
+    sorted_.clear();
+    index_.Match(filter_, sorted_);
+  }
+}
 
-  // Delete all stale objects
-  processes_.erase(
-      remove_if(processes_.begin(), processes_.end(), Process::GetStale),
-      processes_.end());
-  processes_.shrink_to_fit();
-
-  // create new objects from Pids on system but not in processes_ vector
-  vector<int> missingpids{};
-  sort(currentpids.begin(), currentpids.end());
-  sort(cachedpids.begin(), cachedpids.end());
-  set_difference(currentpids.begin(), currentpids.end(), cachedpids.begin(),
-                 cachedpids.end(), inserter(missingpids, missingpids.begin()));
-
-  for (int& missingpid : missingpids) {
-    Process new_proc(missingpid);
-    new_proc.UpdateUtilization();
-    processes_.push_back(new_proc);
+// Newly expanded processes get their threads sampled right away, so they
+// show the average since each thread started until the next tick
+void System::Expand(vector<int> const& pids) {
+  for (int pid : expanded_) {
+    if (std::find(pids.begin(), pids.end(), pid) != pids.end()) continue;
+    if (Process* process = processes_.Find(pid)) process->Expand(false);
+  }
+  for (int pid : pids) {
+    if (std::find(expanded_.begin(), expanded_.end(), pid) != expanded_.end())
+      continue;
+    if (Process* process = processes_.Find(pid)) SampleThreads(*process);
   }
-  // Sort the process_ vector before output
-  sort(processes_.begin(), processes_.end());
-  return processes_;
+  expanded_ = pids;
+}
+
+void System::Reload(Process& process) {
+  process.Load(users_);
+  process.SetCgroupId(cgroups_.Intern(process.Cgroup()));
+  index_.Add(process);
+}
+
+// Threads are listed and read only here, on all workers as a process can
+// have thousands of them
+void System::SampleThreads(Process& process) {
+  process.Expand(true);
+  ThreadTable& threads = *process.Threads();
+  threads.Enumerate();
+  double const uptime = snapshot_.uptime;
+  pool_.ParallelFor(threads.Size(), [&](size_t i) {
+    threads.Sample(i, uptime, history_);
+  });
+}
+
+// DONE: Order a view of the processes, the processes stay in place.
+// Only the n from first on are sorted: nth_element moves them into place
+// in linear time, so a screen full of rows costs O(N + n log n) wherever
+// the list is scrolled to, and the full sort is left to callers that
+// need every process in order.
+vector<Process*>& System::Order(SortKey key, size_t n, size_t first) {
+  PhaseTimer timer;
+  // Users are compared by name, which is only read when asked for
+  if (key == SortKey::kUser) Resolve(sorted_);
+  auto before = [key](Process* a, Process* b) {
+    return Process::Before(*a, *b, key);
+  };
+  first = std::min(first, sorted_.size());
+  size_t const end = n < sorted_.size() - first ? first + n : sorted_.size();
+  if (first > 0) {
+    std::nth_element(sorted_.begin(), sorted_.begin() + first, sorted_.end(),
+                     before);
+  }
+  if (end < sorted_.size()) {
+    std::nth_element(sorted_.begin() + first, sorted_.begin() + end,
+                     sorted_.end(), before);
+  }
+  sort(sorted_.begin() + first, sorted_.begin() + end, before);
+  phases_.sort_us = timer.Lap();
+  // Only the processes that are shown get their PSS and USS read, once
+  // per tick however often they are reordered. They are not backed off
+  // either, a process on screen shows the CPU of every tick.
+  unsigned long const tick = tick_;
+  pool_.ParallelFor(end - first, [&](size_t i) {
+    sorted_[first + i]->UpdateMemoryDetail(tick);
+    sorted_[first + i]->Watch();
+  });
+  // Reading them is sampling, reorders between ticks add next to nothing
+  phases_.sample_us += timer.Lap();
+  return sorted_;
+}
+
+vector<ControlGroup const*> const& System::Cgroups(SortKey key, size_t n) {
+  return cgroups_.Order(key, n);
 }
 
 // DONE: Return the system's kernel identifier (string)
-std::string System::Kernel() { return kernel_; }
+std::string const& System::Kernel() { return kernel_; }
 
 // DONE: Return the system's memory utilization
-float System::MemoryUtilization() { return LinuxParser::MemoryUtilization(); }
+float System::MemoryUtilization() { return snapshot_.MemoryUtilization(); }
 
 // DONE: Return the operating system name
-std::string System::OperatingSystem() { return osname_; }
+std::string const& System::OperatingSystem() { return osname_; }
 
 // DONE: Return the number of processes actively running on the system
-int System::RunningProcesses() { return LinuxParser::RunningProcesses(); }
+int System::RunningProcesses() { return snapshot_.running_processes; }
 
 // DONE: Return the total number of processes on the system
-int System::TotalProcesses() { return LinuxParser::TotalProcesses(); }
+int System::TotalProcesses() { return snapshot_.total_processes; }
+
+unsigned long System::Samples() {
+  return warming_.empty() ? tick_ : tick_ - 1;
+}
+
+size_t System::SampledProcesses() { return sampled_; }
+
+PhaseTimes const& System::Phases() { return phases_; }
+
+int System::ShortLivedProcesses() { return pids_.ShortLived(); }
 
 // DONE: Return the number of seconds since the system started running
-long System::UpTime() { return LinuxParser::UpTime(); }
\ No newline at end of file
+long System::UpTime() { return long(snapshot_.uptime); }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "thread_table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "cpu_history.h"
+#include "linux_parser.h"
+
+using std::vector;
+
+ThreadTable::ThreadTable(int pid) : pid_(pid) {}
+
+// Merges the sorted TIDs with the sorted threads of the last tick, so
+// known threads keep their history and vanished ones are dropped
+void ThreadTable::Enumerate() {
+  LinuxParser::Tids(pid_, tids_);
+  std::sort(tids_.begin(), tids_.end());
+  vector<Thread> threads;
+  threads.reserve(tids_.size());
+  size_t known{0};
+  for (int tid : tids_) {
+    while (known < threads_.size() && threads_[known].tid < tid) ++known;
+    if (known < threads_.size() && threads_[known].tid == tid) {
+      threads.push_back(std::move(threads_[known]));
+    } else {
+      threads.emplace_back();
+      threads.back().tid = tid;
+    }
+  }
+  threads_.swap(threads);
+  order_.clear();
+}
+
+size_t ThreadTable::Size() const { return threads_.size(); }
+
+void ThreadTable::Sample(size_t i, double uptime,
+                         CpuHistoryConfig const& config) {
+  Thread& thread = threads_[i];
+  LinuxParser::ThreadSample sample;
+  if (!LinuxParser::ReadThreadSample(pid_, thread.tid, sample)) return;
+  thread.name.assign(sample.name);
+  // A reused TID is a new thread, like a reused PID is a new process
+  if (thread.starttime != 0 && sample.starttime != thread.starttime) {
+    thread.history = CpuHistory();
+  }
+  thread.starttime = sample.starttime;
+  thread.history.Update(
+      TaskTicks(sample.utime + sample.stime, sample.starttime, uptime),
+      config);
+}
+
+// Ties are broken by TID like processes are by PID
+vector<Thread const*> const& ThreadTable::Hottest() {
+  order_.clear();
+  for (Thread const& thread : threads_) order_.push_back(&thread);
+  std::sort(order_.begin(), order_.end(), [](Thread const* a, Thread const* b) {
+    if (a->history.Utilization() != b->history.Utilization())
+      return a->history.Utilization() > b->history.Utilization();
+    return a->tid < b->tid;
+  });
+  return order_;
+}
@@ -0,0 +1,96 @@
+#include "user_cache.h"
+
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_reader.h"
+
+using std::string;
+using std::string_view;
+
+UserCache::UserCache(string passwd)
+    : passwd_(passwd.empty() ? LinuxParser::kPasswordPath
+                             : std::move(passwd)) {}
+
+void UserCache::Revalidate() {
+  struct stat status;
+  if (stat(passwd_.c_str(), &status) != 0) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (status.st_mtim.tv_sec != mtime_.tv_sec ||
+      status.st_mtim.tv_nsec != mtime_.tv_nsec) {
+    mtime_ = status.st_mtim;
+    loaded_ = false;
+  }
+}
+
+// DONE: Return the user name of a UID, an empty string if it has none
+string UserCache::Name(uid_t uid) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loaded_) Load();
+    auto it = names_.find(uid);
+    if (it != names_.end()) return it->second;
+  }
+
+  // Not in the passwd file, ask NSS without the lock: it may wait for a
+  // directory server, the other workers should not wait along
+  string name;
+  long size = sysconf(_SC_GETPW_R_SIZE_MAX);
+  std::vector<char> buffer(size > 0 ? size : 16384);
+  struct passwd entry;
+  struct passwd *result = nullptr;
+  int error;
+  while ((error = getpwuid_r(uid, &entry, buffer.data(), buffer.size(),
+                             &result)) == ERANGE) {
+    buffer.resize(buffer.size() * 2);
+  }
+  if (error == 0 && result != nullptr) name = result->pw_name;
+  // No such user is an answer worth keeping, a failed lookup is not. Per
+  // getpwuid_r(3) these are the codes an unknown UID may come back with.
+  bool const answered =
+      error == 0 || error == ENOENT || error == ESRCH || error == EBADF ||
+      error == EPERM;
+  if (answered) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    names_.emplace(uid, name);
+  }
+  return name;
+}
+
+// Parses the whole passwd file in one pass. The lines are split on every
+// ':' so an empty field, like a blank password, still counts as one; the
+// username is on the 1st and the userid on the 3rd position. Lines with
+// fewer fields are no entries.
+void UserCache::Load() {
+  names_.clear();
+  loaded_ = true;
+  ProcReader reader;
+  if (!reader.Read(passwd_.c_str())) return;
+  Tokenizer lines(reader.Content());
+  string_view line;
+  while (lines.NextLine(line)) {
+    string_view fields[3];
+    size_t count{0};
+    size_t begin{0};
+    while (count < 3) {
+      size_t const end = line.find(':', begin);
+      fields[count++] = line.substr(begin, end - begin);
+      if (end == string_view::npos) break;
+      begin = end + 1;
+    }
+    if (count < 3 || fields[0].empty()) continue;
+    uid_t uid;
+    if (ParseNumber(fields[2], uid)) {
+      names_.emplace(uid, string(fields[0]));
+    }
+  }
+}
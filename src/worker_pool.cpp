@@ -0,0 +1,83 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace {
+// Items are claimed in chunks to keep the shared counters cold
+constexpr size_t kChunk{16};
+}  // namespace
+
+WorkerPool::WorkerPool(unsigned workers) {
+  if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+  shares_ = std::vector<Share>(workers);
+  for (unsigned worker = 1; worker < workers; ++worker) {
+    threads_.emplace_back(&WorkerPool::Loop, this, worker);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+unsigned WorkerPool::Workers() const { return shares_.size(); }
+
+// Splits the range evenly over the workers, wakes them up and works along
+void WorkerPool::Run(size_t count, void* context, Task task) {
+  if (count == 0) return;
+  size_t const workers = shares_.size();
+  for (size_t worker = 0; worker < workers; ++worker) {
+    shares_[worker].next.store(count * worker / workers,
+                               std::memory_order_relaxed);
+    shares_[worker].end = count * (worker + 1) / workers;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    context_ = context;
+    task_ = task;
+    busy_ = threads_.size();
+    ++job_;
+  }
+  start_.notify_all();
+  Work(0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return busy_ == 0; });
+}
+
+// Drains the own share first, then steals from the other workers' shares
+void WorkerPool::Work(unsigned worker) {
+  size_t const workers = shares_.size();
+  for (size_t offset = 0; offset < workers; ++offset) {
+    Share& share = shares_[(worker + offset) % workers];
+    while (true) {
+      size_t begin = share.next.fetch_add(kChunk, std::memory_order_relaxed);
+      if (begin >= share.end) break;
+      size_t end = std::min(begin + kChunk, share.end);
+      for (size_t index = begin; index < end; ++index) {
+        task_(context_, index, worker);
+      }
+    }
+  }
+}
+
+void WorkerPool::Loop(unsigned worker) {
+  unsigned long seen{0};
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return stop_ || job_ != seen; });
+      if (stop_) return;
+      seen = job_;
+    }
+    Work(worker);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--busy_ == 0) done_.notify_one();
+  }
+}
@@ -0,0 +1,239 @@
+#include "aggregator.h"
+
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "linux_parser.h"
+#include "procfs_fixture.h"
+#include "recorder.h"
+#include "snapshot.h"
+#include "socket_address.h"
+#include "system.h"
+#include "temp_directory.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// Points the parser at a tree, the parser reads one tree at a time
+void Use(string const& root) {
+  LinuxParser::SetProcDirectory(root);
+  LinuxParser::SetCgroupDirectory(root + "/cgroup");
+}
+
+bool WriteTree(string const& root, int processes) {
+  ProcfsFixture::Write(root, processes);
+  Use(root);
+  return true;
+}
+
+/*
+What an agent does on a host of its own: a system over a synthetic procfs
+tree and a recorder that streams its ticks. Processes come and go by
+moving their directories out of the tree and back.
+*/
+class Host {
+ public:
+  explicit Host(int processes) : processes_(processes) {
+    mkdir(parked_.c_str(), 0755);
+  }
+
+  bool Connect(SocketAddress const& address) {
+    int fd = Socket::Connect(address);
+    if (fd < 0) return false;
+    recorder_.Attach(fd);
+    return true;
+  }
+  bool Open(string const& path) { return recorder_.Open(path); }
+
+  // Samples one tick and streams it like Collector::Collect does
+  bool Tick() {
+    Use(tree_.Path());
+    system_.Refresh();
+    system_.Processes();
+    system_.Resolve(system_.AllProcesses());
+    return recorder_.Write(system_, system_.AllProcesses());
+  }
+
+  // Ends the processes from first to last, or starts them again
+  void Park(int first, int last) { Move(tree_.Path(), parked_, first, last); }
+  void Unpark(int first, int last) {
+    Move(parked_, tree_.Path(), first, last);
+  }
+
+  int Processes() const { return processes_; }
+
+ private:
+  static void Move(string const& from, string const& to, int first,
+                   int last) {
+    for (int pid = first; pid <= last; ++pid) {
+      string const name = "/" + std::to_string(pid);
+      rename((from + name).c_str(), (to + name).c_str());
+    }
+  }
+
+  int const processes_;
+  TempDirectory tree_;
+  bool const written_{WriteTree(tree_.Path(), processes_)};
+  string const parked_{tree_.Path() + "/parked"};
+  System system_;
+  Recorder recorder_;
+};
+
+// A loopback address nothing listens on, for the aggregator to take
+SocketAddress FreeLoopbackAddress() {
+  SocketAddress address;
+  Socket::ParseAddress("127.0.0.1:0", address);
+  int const fd = Socket::Listen(address);
+  sockaddr_in bound{};
+  socklen_t size = sizeof(bound);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &size);
+  close(fd);
+  address.port = std::to_string(ntohs(bound.sin_port));
+  return address;
+}
+
+// Takes in what the hosts sent until the aggregator saw samples ticks
+Snapshot const& Await(Aggregator& aggregator, unsigned long samples) {
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (true) {
+    Snapshot const& snapshot = aggregator.Latest();
+    if (snapshot.samples >= samples ||
+        std::chrono::steady_clock::now() > deadline) {
+      return snapshot;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+// Checks the merged rows against the processes each host should have
+void CheckMerged(Snapshot const& snapshot, vector<int> expected) {
+  int total{0};
+  for (int processes : expected) total += processes;
+  CHECK(snapshot.hosts);
+  CHECK_EQ(snapshot.process_count, size_t(total));
+  REQUIRE_EQ(snapshot.rows.size(), size_t(total));
+  std::map<string, int> per_host;
+  for (size_t i = 0; i < snapshot.rows.size(); ++i) {
+    ProcessRow const& row = snapshot.rows[i];
+    ++per_host[row.host];
+    CHECK(!row.user.empty());
+    CHECK(row.command.find("--id " + std::to_string(row.pid)) !=
+          string::npos);
+    // Ordered by PID, the same PID on several hosts by host
+    if (i > 0) {
+      ProcessRow const& before = snapshot.rows[i - 1];
+      CHECK(before.pid < row.pid ||
+            (before.pid == row.pid && before.host < row.host));
+    }
+  }
+  // The hosts are told apart, agents on one machine by a number
+  vector<int> counts;
+  for (auto const& host : per_host) {
+    CHECK(!host.first.empty());
+    counts.push_back(host.second);
+  }
+  std::sort(counts.begin(), counts.end());
+  std::sort(expected.begin(), expected.end());
+  CHECK(counts == expected);
+}
+
+// Size of the file after every tick, less the size before
+vector<long> TickSizes(Host& host, string const& path, int ticks) {
+  vector<long> sizes;
+  host.Open(path);
+  struct stat status;
+  long before{0};
+  for (int tick = 0; tick < ticks; ++tick) {
+    host.Tick();
+    stat(path.c_str(), &status);
+    sizes.push_back(status.st_size - before);
+    before = status.st_size;
+  }
+  return sizes;
+}
+}  // namespace
+
+TEST(AggregatorMergesAgentsOnLoopback) {
+  SocketAddress const address = FreeLoopbackAddress();
+  Aggregator aggregator;
+  REQUIRE(aggregator.Listen(address));
+  aggregator.Request(SortKey::kPid, 1000);
+  vector<std::unique_ptr<Host>> hosts;
+  for (int processes : {30, 50, 80}) {
+    hosts.push_back(std::make_unique<Host>(processes));
+    REQUIRE(hosts.back()->Connect(address));
+  }
+
+  unsigned long samples{0};
+  auto tick = [&] {
+    for (auto const& host : hosts) CHECK(host->Tick());
+    samples += hosts.size();
+    return Await(aggregator, samples);
+  };
+  CheckMerged(tick(), {30, 50, 80});
+  // Processes end on one host and start on another
+  hosts[1]->Park(11, 30);
+  hosts[2]->Park(1, 5);
+  CheckMerged(tick(), {30, 30, 75});
+  hosts[1]->Unpark(11, 30);
+  CheckMerged(tick(), {30, 50, 75});
+
+  // A host that goes away takes its processes along
+  hosts.pop_back();
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (aggregator.Latest().process_count != 80 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CheckMerged(aggregator.Latest(), {30, 50});
+}
+
+// After the first tick, the bytes of a tick follow the processes that
+// changed and not the processes there are
+TEST(AgentTrafficFollowsChurn) {
+  TempDirectory directory;
+  Host small(200);
+  vector<long> const small_ticks =
+      TickSizes(small, directory.Path() + "/small", 4);
+  Host large(1000);
+  vector<long> const large_ticks =
+      TickSizes(large, directory.Path() + "/large", 4);
+  CHECK(large_ticks[0] > 4 * small_ticks[0]);
+  long const steady = small_ticks.back();
+  CHECK(steady < 64);
+  CHECK(large_ticks.back() <= steady + 8);
+
+  // Twice the churn costs about twice the bytes
+  long churned[2];
+  for (int i = 0; i < 2; ++i) {
+    int const ended = 50 * (i + 1);
+    large.Park(1, ended);
+    large.Tick();
+    large.Unpark(1, ended);
+    struct stat before, after;
+    string const path = directory.Path() + "/large";
+    stat(path.c_str(), &before);
+    large.Tick();
+    stat(path.c_str(), &after);
+    churned[i] = after.st_size - before.st_size;
+    // Every process that started again is sent with its values
+    CHECK(churned[i] > steady + 4 * ended);
+  }
+  CHECK(churned[1] > churned[0] * 3 / 2);
+  CHECK(churned[1] < large_ticks[0] / 10);
+}
@@ -0,0 +1,62 @@
+#include "cgroup_table.h"
+
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "cpu_history.h"
+#include "linux_parser.h"
+#include "procfs_fixture.h"
+#include "process.h"
+#include "temp_directory.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+string Unit(int unit) {
+  return "/bench.slice/unit-" + std::to_string(unit) + ".service";
+}
+}  // namespace
+
+TEST(CgroupTableDropsCgroupsWithoutProcesses) {
+  TempDirectory tree;
+  ProcfsFixture::Write(tree.Path(), 1);
+  LinuxParser::SetCgroupDirectory(tree.Path() + "/cgroup");
+  CpuHistoryConfig const config;
+  CgroupTable table;
+  Process first(1), second(2), third(3);
+  vector<Process*> processes{&first, &second, &third};
+  first.SetCgroupId(table.Intern(Unit(1)));
+  second.SetCgroupId(table.Intern(Unit(2)));
+  third.SetCgroupId(table.Intern(Unit(2)));
+  CHECK_EQ(first.CgroupId(), 0u);
+  CHECK_EQ(second.CgroupId(), third.CgroupId());
+  CHECK_EQ(table.Intern(""), CgroupTable::kNone);
+
+  table.Count(processes);
+  REQUIRE_EQ(table.Size(), 2u);
+  for (size_t i = 0; i < table.Size(); ++i) table.Sample(i, 100, config);
+  vector<ControlGroup const*> order = table.Order(SortKey::kPid, 10);
+  REQUIRE_EQ(order.size(), 2u);
+  CHECK_EQ(order[0]->path, Unit(1));
+  CHECK_EQ(order[1]->processes, 2);
+
+  // The processes of unit 1 are gone, the next cgroup takes its slot
+  processes.erase(processes.begin());
+  table.Count(processes);
+  CHECK_EQ(table.Size(), 1u);
+  order = table.Order(SortKey::kPid, 10);
+  REQUIRE_EQ(order.size(), 1u);
+  CHECK_EQ(order[0]->path, Unit(2));
+  first.SetCgroupId(table.Intern(Unit(3)));
+  CHECK_EQ(first.CgroupId(), 0u);
+  processes.push_back(&first);
+  table.Count(processes);
+  for (size_t i = 0; i < table.Size(); ++i) table.Sample(i, 100, config);
+  order = table.Order(SortKey::kPid, 10);
+  REQUIRE_EQ(order.size(), 2u);
+  CHECK_EQ(order[1]->path, Unit(3));
+  // Only sampled once in its new slot, it has no history of unit 1
+  CHECK_EQ(order[1]->history.Samples(), 1u);
+}
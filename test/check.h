@@ -0,0 +1,64 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+The few pieces of a test runner the tests need. TEST registers a case
+that monitor_test runs, CHECK marks the case failed and goes on, REQUIRE
+returns from it.
+*/
+namespace Check {
+struct Case {
+  char const* name;
+  void (*run)();
+};
+std::vector<Case>& Cases();
+// Failed checks of the case that runs
+int& Failures();
+
+struct Register {
+  Register(char const* name, void (*run)()) {
+    Cases().push_back({name, run});
+  }
+};
+
+template <typename A, typename B>
+bool Equal(A const& a, B const& b, char const* expression, char const* file,
+           int line) {
+  if (a == b) return true;
+  std::ostringstream message;
+  message << file << ":" << line << ": " << expression << ": " << a
+          << " != " << b << "\n";
+  std::cerr << message.str();
+  ++Failures();
+  return false;
+}
+
+inline bool True(bool value, char const* expression, char const* file,
+                 int line) {
+  if (value) return true;
+  std::cerr << file << ":" << line << ": " << expression << " is false\n";
+  ++Failures();
+  return false;
+}
+}  // namespace Check
+
+#define TEST(name)                                              \
+  void name();                                                  \
+  static Check::Register const name##_registered(#name, name); \
+  void name()
+
+#define CHECK(condition) \
+  Check::True((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) \
+  Check::Equal((a), (b), #a " == " #b, __FILE__, __LINE__)
+#define REQUIRE(condition) \
+  if (!CHECK(condition)) return
+#define REQUIRE_EQ(a, b) \
+  if (!CHECK_EQ(a, b)) return
+
+#endif
@@ -0,0 +1,74 @@
+#include "cpu_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "check.h"
+
+namespace {
+// A task that idles for 8 ticks and then uses half a CPU, each tick is
+// 100 clock ticks long
+CpuTicks At(int tick) {
+  CpuTicks ticks;
+  ticks.total = 100 * tick;
+  ticks.busy = tick > 8 ? 50 * (tick - 8) : 0;
+  return ticks;
+}
+
+// Samples every tick next to samples that back off like an idle process,
+// at most as far as the horizon, and carry the busy time in between. The
+// busy time that is spread over them has to come out the same.
+void CheckSpread(CpuHistoryConfig const& config) {
+  int const horizon = Horizon(config);
+  std::vector<int> backed_off;
+  for (int tick = 0, interval = 1; tick < 16;) {
+    tick = tick < 8 ? std::min(tick + interval, 8) : tick + interval;
+    backed_off.push_back(tick);
+    if (tick < 8) {
+      interval = std::min(interval * 2, horizon);
+    } else {
+      // The task woke up after 8, which shows at the next sample
+      interval = tick == 8 ? std::min(4, horizon) : 1;
+    }
+  }
+  CpuHistory every, sparse;
+  int last{0};
+  every.Update(At(0), config);
+  sparse.Update(At(0), config);
+  for (int tick = 1; tick <= 16; ++tick) {
+    every.Update(At(tick), config);
+    bool sampled{false};
+    for (int sample : backed_off) sampled = sampled || sample == tick;
+    if (!sampled) {
+      CpuTicks carried = At(tick);
+      carried.busy = sparse.Latest().busy;
+      sparse.Update(carried, config);
+      continue;
+    }
+    sparse.Update(At(tick), config, tick - last - 1);
+    last = tick;
+    CHECK(std::fabs(every.Utilization() - sparse.Utilization()) < 1e-4);
+    CHECK(sparse.Utilization() <= 1);
+  }
+  CHECK(sparse.Utilization() > 0.3);
+}
+}  // namespace
+
+TEST(CpuHistorySpreadsCarriedTimeOverTheWindow) {
+  CheckSpread({UtilizationMode::kSlidingWindow, 4, 0.3});
+  CheckSpread({UtilizationMode::kSlidingWindow, 10, 0.3});
+}
+
+TEST(CpuHistorySpreadsCarriedTimeOverTheMovingAverage) {
+  CheckSpread({UtilizationMode::kEwma, 10, 0.3});
+  CheckSpread({UtilizationMode::kEwma, 10, 0.5});
+}
+
+TEST(CpuHistoryHorizonBoundsTheBackOff) {
+  CHECK_EQ(Horizon({UtilizationMode::kSlidingWindow, 10, 0.3}), 10u);
+  CHECK_EQ(Horizon({UtilizationMode::kEwma, 10, 0.3}), 4u);
+  CHECK_EQ(Horizon({UtilizationMode::kEwma, 10, 0.01}),
+           unsigned(CpuHistory::kMaxWindow));
+}
@@ -0,0 +1,300 @@
+#include "exporter.h"
+
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "collector.h"
+#include "linux_parser.h"
+#include "options.h"
+#include "output_buffer.h"
+#include "procfs_fixture.h"
+#include "socket_address.h"
+#include "system.h"
+#include "temp_directory.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+constexpr int kProcesses{200};
+constexpr std::size_t kRows{20};
+
+struct Response {
+  string status;
+  long content_length{-1};
+  string body;
+};
+
+// Sends one request and reads the response until the server closes
+Response Get(SocketAddress const& address, string const& target) {
+  Response response;
+  int fd = Socket::Connect(address);
+  if (fd < 0) return response;
+  string const request = "GET " + target + " HTTP/1.1\r\nHost: test\r\n\r\n";
+  send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+  string raw;
+  char buffer[4096];
+  ssize_t count;
+  while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+    raw.append(buffer, count);
+  }
+  close(fd);
+  size_t const head_end = raw.find("\r\n\r\n");
+  if (raw.rfind("HTTP/1.1 ", 0) != 0 || head_end == string::npos) {
+    return response;
+  }
+  response.status = raw.substr(9, raw.find("\r\n") - 9);
+  size_t const length = raw.find("Content-Length: ");
+  if (length != string::npos && length < head_end) {
+    response.content_length = std::strtol(raw.c_str() + length + 16,
+                                          nullptr, 10);
+  }
+  response.body = raw.substr(head_end + 4);
+  return response;
+}
+
+// Scrapes until the first tick was sampled in full
+Response AwaitSample(SocketAddress const& address) {
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  Response response;
+  do {
+    response = Get(address, "/metrics");
+    if (response.body.find("monitor_samples_total 1\n") != string::npos) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  } while (std::chrono::steady_clock::now() < deadline);
+  return response;
+}
+
+// Every line is a HELP or TYPE comment or a metric, optionally with
+// labels, and a number
+void CheckExposition(string const& body) {
+  REQUIRE(!body.empty());
+  CHECK_EQ(body.back(), '\n');
+  size_t begin{0};
+  while (begin < body.size()) {
+    size_t const end = body.find('\n', begin);
+    string const line = body.substr(begin, end - begin);
+    begin = end + 1;
+    if (line.rfind("# HELP monitor_", 0) == 0 ||
+        line.rfind("# TYPE monitor_", 0) == 0) {
+      continue;
+    }
+    CHECK_EQ(line.rfind("monitor_", 0), 0u);
+    size_t const space = line.rfind(' ');
+    REQUIRE(space != string::npos);
+    char* value_end{nullptr};
+    std::strtod(line.c_str() + space + 1, &value_end);
+    CHECK_EQ(*value_end, '\0');
+  }
+}
+
+// Points the parser at a new tree, before the system reads it. A command
+// given replaces the command line of every process.
+bool WriteTree(string const& root, string const& command) {
+  ProcfsFixture::Write(root, kProcesses);
+  for (int pid = 1; pid <= kProcesses && !command.empty(); ++pid) {
+    std::ofstream(root + "/" + std::to_string(pid) + "/cmdline",
+                  std::ios::binary | std::ios::trunc)
+        << command;
+  }
+  LinuxParser::SetProcDirectory(root);
+  LinuxParser::SetCgroupDirectory(root + "/cgroup");
+  return true;
+}
+
+// CPU time of the whole test process, the server thread included
+double CpuSeconds() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+size_t Count(string const& text, string const& part) {
+  size_t count{0};
+  for (size_t at = text.find(part); at != string::npos;
+       at = text.find(part, at + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+// A collector over a synthetic procfs tree that is sampled once, the next
+// tick is an hour away, and an exporter serving it on a thread
+class Served {
+ public:
+  explicit Served(int listener, string command = "")
+      : command_(std::move(command)), listener_(listener) {
+    collector_.Request(SortKey::kCpu, kRows);
+    collector_.Start();
+    server_ = std::thread(
+        [this] { Exporter::Serve(listener_, collector_, stop_); });
+  }
+  ~Served() {
+    stop_ = true;
+    server_.join();
+    close(listener_);
+  }
+
+  std::string const& Tree() const { return tree_.Path(); }
+
+ private:
+  string const command_;
+  TempDirectory tree_;
+  bool const written_{WriteTree(tree_.Path(), command_)};
+  System system_;
+  Collector collector_{system_, std::chrono::hours(1)};
+  int const listener_;
+  std::atomic<bool> stop_{false};
+  std::thread server_;
+};
+}  // namespace
+
+TEST(ExporterServesLoopbackScrapesFromTheLastSample) {
+  SocketAddress address;
+  REQUIRE(Socket::ParseAddress("127.0.0.1:0", address));
+  int const listener = Socket::Listen(address);
+  REQUIRE(listener >= 0);
+  sockaddr_in bound{};
+  socklen_t size = sizeof(bound);
+  getsockname(listener, reinterpret_cast<sockaddr*>(&bound), &size);
+  address.port = std::to_string(ntohs(bound.sin_port));
+  Served served(listener);
+
+  Response const first = AwaitSample(address);
+  REQUIRE_EQ(first.status, "200 OK");
+  // A scrape that read procfs now would find no processes at all
+  std::filesystem::remove_all(served.Tree());
+
+  Response scrapes[2];
+  std::thread concurrent[2];
+  for (int i = 0; i < 2; ++i) {
+    concurrent[i] =
+        std::thread([&, i] { scrapes[i] = Get(address, "/metrics"); });
+  }
+  for (std::thread& scrape : concurrent) scrape.join();
+  for (Response const& scrape : scrapes) {
+    CHECK_EQ(scrape.status, "200 OK");
+    CHECK_EQ(scrape.content_length, long(scrape.body.size()));
+    CHECK(scrape.body == first.body);
+    CheckExposition(scrape.body);
+    CHECK(scrape.body.find("\nmonitor_processes " +
+                           std::to_string(kProcesses) + "\n") !=
+          string::npos);
+    CHECK_EQ(Count(scrape.body, "\nmonitor_process_cpu_utilization{"),
+             kRows);
+  }
+  CHECK_EQ(Get(address, "/other").status, "404 Not Found");
+}
+
+TEST(ExporterServesAUnixSocket) {
+  TempDirectory directory;
+  SocketAddress address;
+  REQUIRE(Socket::ParseAddress("unix:" + directory.Path() + "/sock",
+                               address));
+  int const listener = Socket::Listen(address);
+  REQUIRE(listener >= 0);
+  Served served(listener);
+
+  Response const scrape = AwaitSample(address);
+  CHECK_EQ(scrape.status, "200 OK");
+  CHECK_EQ(scrape.content_length, long(scrape.body.size()));
+  CheckExposition(scrape.body);
+}
+
+// Clients that connect but never send keep their slots until they time
+// out, the server waits for them without spinning
+TEST(ExporterWaitsWhileAllClientsAreTaken) {
+  // One more than the clients Serve takes
+  constexpr int kClients{65};
+  TempDirectory directory;
+  SocketAddress address;
+  REQUIRE(Socket::ParseAddress("unix:" + directory.Path() + "/sock",
+                               address));
+  int const listener = Socket::Listen(address);
+  REQUIRE(listener >= 0);
+  Served served(listener);
+  REQUIRE_EQ(AwaitSample(address).status, "200 OK");
+
+  std::vector<int> idle;
+  for (int i = 0; i < kClients; ++i) idle.push_back(Socket::Connect(address));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  double const before = CpuSeconds();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  CHECK(CpuSeconds() - before < 0.1);
+
+  for (int fd : idle) close(fd);
+  CHECK_EQ(Get(address, "/metrics").status, "200 OK");
+}
+
+// Commands are not always UTF-8, the exposition has to be
+TEST(ExporterReplacesInvalidUtf8InLabels) {
+  TempDirectory directory;
+  SocketAddress address;
+  REQUIRE(Socket::ParseAddress("unix:" + directory.Path() + "/sock",
+                               address));
+  int const listener = Socket::Listen(address);
+  REQUIRE(listener >= 0);
+  // Latin-1 next to UTF-8, the arguments are split by NUL
+  static char const kCommand[] = "/usr/bin/caf\xe9\0--name\0\xc3\xa9t\xe9\xff";
+  Served served(listener, string(kCommand, sizeof(kCommand)));
+
+  Response const scrape = AwaitSample(address);
+  REQUIRE_EQ(scrape.status, "200 OK");
+  CheckExposition(scrape.body);
+  for (size_t i = 0; i < scrape.body.size();) {
+    size_t const length = Utf8Length(string_view(scrape.body).substr(i));
+    REQUIRE(length > 0);
+    i += length;
+  }
+  // Every command label of every row, whatever the metric
+  size_t const labels = Count(scrape.body, "command=\"");
+  CHECK(labels >= kRows);
+  CHECK_EQ(Count(scrape.body,
+                 "command=\"/usr/bin/caf\xef\xbf\xbd --name "
+                 "\xc3\xa9t\xef\xbf\xbd\xef\xbf\xbd\""),
+           labels);
+}
+
+TEST(SocketListenReplacesOnlyStaleSockets) {
+  TempDirectory directory;
+  string const file = directory.Path() + "/data.db";
+  std::ofstream(file) << "keep";
+  SocketAddress address;
+  REQUIRE(Socket::ParseAddress("unix:" + file, address));
+  CHECK_EQ(Socket::Listen(address), -1);
+  CHECK_EQ(errno, EADDRINUSE);
+  string content;
+  std::ifstream(file) >> content;
+  CHECK_EQ(content, "keep");
+
+  // A socket left behind by a run that did not clean up
+  REQUIRE(Socket::ParseAddress("unix:" + directory.Path() + "/stale.sock",
+                               address));
+  int const stale = Socket::Listen(address);
+  REQUIRE(stale >= 0);
+  close(stale);
+  int const listener = Socket::Listen(address);
+  CHECK(listener >= 0);
+  if (listener >= 0) close(listener);
+}
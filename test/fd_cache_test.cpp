@@ -0,0 +1,32 @@
+#include "fd_cache.h"
+
+#include "check.h"
+#include "linux_parser.h"
+#include "procfs_fixture.h"
+#include "temp_directory.h"
+
+// Processes past the budget read by path, the ones holding files keep
+// them from tick to tick
+TEST(FdCacheKeepsTheSameFilesAtTheBudget) {
+  constexpr int kProcesses{6};
+  TempDirectory tree;
+  ProcfsFixture::Write(tree.Path(), kProcesses);
+  LinuxParser::SetProcDirectory(tree.Path());
+  FdCache cache(4);
+  LinuxParser::ProcessFiles files[kProcesses];
+  int kept[kProcesses];
+  for (int tick = 0; tick < 3; ++tick) {
+    for (int i = 0; i < kProcesses; ++i) {
+      LinuxParser::ProcessSample sample;
+      CHECK(LinuxParser::ReadProcessSample(i + 1, sample, &files[i], &cache));
+      CHECK(sample.rss_kb > 0);
+    }
+    CHECK_EQ(cache.Open(), 4u);
+    for (int i = 0; i < kProcesses; ++i) {
+      // The first two processes took the budget, two files each
+      CHECK_EQ(files[i].stat.IsOpen(), i < 2);
+      if (tick == 0) kept[i] = files[i].stat.Fd();
+      CHECK_EQ(files[i].stat.Fd(), kept[i]);
+    }
+  }
+}
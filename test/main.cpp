@@ -0,0 +1,33 @@
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "check.h"
+
+std::vector<Check::Case>& Check::Cases() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+int& Check::Failures() {
+  static int failures{0};
+  return failures;
+}
+
+// Runs the cases whose name contains the argument, all without one
+int main(int argc, char* argv[]) {
+  // Closed sockets show up as failed writes
+  signal(SIGPIPE, SIG_IGN);
+  int failed{0};
+  for (Check::Case const& test : Check::Cases()) {
+    if (argc > 1 && strstr(test.name, argv[1]) == nullptr) continue;
+    Check::Failures() = 0;
+    test.run();
+    bool const passed = Check::Failures() == 0;
+    printf("%-6s %s\n", passed ? "ok" : "FAILED", test.name);
+    fflush(stdout);
+    if (!passed) ++failed;
+  }
+  return failed == 0 ? 0 : 1;
+}
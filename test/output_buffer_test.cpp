@@ -0,0 +1,44 @@
+#include "output_buffer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "check.h"
+#include "temp_directory.h"
+
+using std::string;
+
+namespace {
+// What AppendJson writes for text
+string Json(string const& text) {
+  TempDirectory directory;
+  string const path = directory.Path() + "/out";
+  int const fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  {
+    OutputBuffer out(fd);
+    out.AppendJson(text);
+  }
+  close(fd);
+  std::ifstream file(path);
+  return string(std::istreambuf_iterator<char>(file), {});
+}
+}  // namespace
+
+TEST(OutputBufferEscapesJson) {
+  CHECK_EQ(Json("a \"b\"\\\n\t\x01"), "\"a \\\"b\\\"\\\\\\n\\t\\u0001\"");
+  // Valid UTF-8 is kept as it is
+  CHECK_EQ(Json("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80"),
+           "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"");
+}
+
+TEST(OutputBufferEscapesInvalidUtf8) {
+  // A stray continuation byte, Latin-1 and a sequence cut short
+  CHECK_EQ(Json("\x80x\xe9t\xe2\x82"), "\"\\u0080x\\u00e9t\\u00e2\\u0082\"");
+  // Overlong forms and surrogates
+  CHECK_EQ(Json("\xc0\xaf\xed\xa0\x80"),
+           "\"\\u00c0\\u00af\\u00ed\\u00a0\\u0080\"");
+}
@@ -0,0 +1,39 @@
+#include "pid_source.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "check.h"
+#include "linux_parser.h"
+
+namespace {
+bool Has(std::vector<int> const& pids, int pid) {
+  return std::find(pids.begin(), pids.end(), pid) != pids.end();
+}
+}  // namespace
+
+// Whether the subscription went through or not, the PIDs follow the
+// processes that come and go
+TEST(PidSourceFollowsProcessesWithOrWithoutEvents) {
+  // Other tests point the parser at synthetic trees
+  LinuxParser::SetProcDirectory("/proc");
+  for (bool listen : {false, true}) {
+    PidSource source(listen);
+    CHECK(Has(source.Pids(), getpid()));
+    pid_t const child = fork();
+    if (child == 0) {
+      pause();
+      _exit(0);
+    }
+    REQUIRE(child > 0);
+    CHECK(Has(source.Pids(), child));
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    CHECK(!Has(source.Pids(), child));
+    CHECK_EQ(source.ShortLived() < 0, !source.Listening());
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef TEMP_DIRECTORY_H
+#define TEMP_DIRECTORY_H
+
+#include <stdlib.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+// A directory under /tmp that is removed with everything in it
+class TempDirectory {
+ public:
+  TempDirectory() {
+    char path[] = "/tmp/monitor_test.XXXXXX";
+    if (mkdtemp(path) == nullptr) {
+      throw std::runtime_error("cannot create a directory in /tmp");
+    }
+    path_ = path;
+  }
+  ~TempDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path_, error);
+  }
+  TempDirectory(TempDirectory const&) = delete;
+  TempDirectory& operator=(TempDirectory const&) = delete;
+
+  std::string const& Path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+#endif
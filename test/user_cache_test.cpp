@@ -0,0 +1,27 @@
+#include "user_cache.h"
+
+#include <fstream>
+#include <string>
+
+#include "check.h"
+#include "temp_directory.h"
+
+// Empty fields count like any other, the UID is always the 3rd one
+TEST(UserCacheSplitsPasswdOnEveryColon) {
+  TempDirectory directory;
+  std::string const passwd = directory.Path() + "/passwd";
+  std::ofstream(passwd) << "root:x:0:0:root:/root:/bin/bash\n"
+                           "blank::70001:70002::/home/blank:/bin/sh\n"
+                           "short:70003\n"
+                           ":x:70004:70004:no name:/:/bin/false\n"
+                           "last:x:70005\n";
+  UserCache users(passwd);
+  users.Revalidate();
+  CHECK_EQ(users.Name(0), "root");
+  CHECK_EQ(users.Name(70001), "blank");
+  // Not the UID of the blank password entry, nor of the short line
+  CHECK(users.Name(70002) != "blank");
+  CHECK(users.Name(70003) != "short");
+  CHECK_EQ(users.Name(70004), "");
+  CHECK_EQ(users.Name(70005), "last");
+}